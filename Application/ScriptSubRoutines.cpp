@@ -10,7 +10,6 @@ void WireframeHandler(Scop::NonOwningPtr<Scop::Scene> scene, Scop::Inputs& input
 	else if(key_pressed_last_frame)
 	{
 		scene->GetForwardData().wireframe = !scene->GetForwardData().wireframe;
-		Scop::RenderCore::Get().WaitDeviceIdle();
 		scene->GetPipeline().Destroy();
 		key_pressed_last_frame = false;
 	}
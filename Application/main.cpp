@@ -68,6 +68,7 @@ int main(int ac, char** av)
 
 	Scop::SceneDescriptor main_scene_desc;
 	main_scene_desc.fragment_shader = Scop::RenderCore::Get().GetDefaultFragmentShader();
+	main_scene_desc.opaque_fragment_shader = Scop::RenderCore::Get().GetOpaqueFragmentShader();
 	main_scene_desc.camera = std::make_shared<Scop::FirstPerson3D>(Scop::Vec3f{ -10.0f, 0.0f, 0.0f });
 	Scop::Scene& main_scene = splashscreen_scene.AddChildScene("main", main_scene_desc);
 	Scop::Vec2ui32 skybox_size;
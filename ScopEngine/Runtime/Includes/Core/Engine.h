@@ -56,6 +56,7 @@ namespace Scop
 			std::filesystem::path m_assets_path;
 			std::unique_ptr<RenderCore> p_renderer_core;
 			NonOwningPtr<Scene> p_current_scene;
+			std::uint64_t m_startup_begin = 0;
 			bool m_running = true;
 			bool m_scene_changed = false;
 	};
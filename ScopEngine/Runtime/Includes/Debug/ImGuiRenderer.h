@@ -20,6 +20,7 @@ namespace Scop
 
 			bool BeginFrame();
 			void DisplayRenderStatistics();
+			void DisplayMemoryStatistics();
 			void EndFrame();
 
 			~ImGuiRenderer() = default;
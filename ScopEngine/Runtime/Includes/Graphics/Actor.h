@@ -1,6 +1,8 @@
 #ifndef __SCOP_RENDERER_ACTOR__
 #define __SCOP_RENDERER_ACTOR__
 
+#include <cstdint>
+
 #include <Maths/Vec3.h>
 #include <Maths/Vec4.h>
 #include <Maths/Quaternions.h>
@@ -19,9 +21,9 @@ namespace Scop
 			void Update(NonOwningPtr<class Scene> scene, class Inputs& input, float timestep);
 
 			inline void SetColor(Vec4f color) noexcept { m_color = color; }
-			inline void SetPosition(Vec3f position) noexcept { m_position = position; }
-			inline void SetScale(Vec3f scale) noexcept { m_scale = scale; }
-			inline void SetOrientation(Quatf orientation) noexcept { m_orientation = orientation; }
+			inline void SetPosition(Vec3f position) noexcept { m_position = position; m_transform_version = ++s_transform_counter; }
+			inline void SetScale(Vec3f scale) noexcept { m_scale = scale; m_transform_version = ++s_transform_counter; }
+			inline void SetOrientation(Quatf orientation) noexcept { m_orientation = orientation; m_transform_version = ++s_transform_counter; }
 
 			[[nodiscard]] inline const Vec4f& GetColor() const noexcept { return m_color; }
 			[[nodiscard]] inline const Vec3f& GetPosition() const noexcept { return m_position; }
@@ -29,16 +31,21 @@ namespace Scop
 			[[nodiscard]] inline const Quatf& GetOrientation() const noexcept { return m_orientation; }
 			[[nodiscard]] inline const Model& GetModel() const noexcept { return m_model; }
 			[[nodiscard]] inline Model& GetModelRef() noexcept { return m_model; }
+			// Unique among all actors, changes each time the transform is modified
+			[[nodiscard]] inline std::uint64_t GetTransformVersion() const noexcept { return m_transform_version; }
 
 			~Actor();
 
 		private:
+			inline static std::uint64_t s_transform_counter = 0;
+
 			Model m_model;
 			Quatf m_orientation = Quatf::Identity();
 			Vec4f m_color = Vec4f{ 1.0f, 1.0f, 1.0f, 1.0f };
 			Vec3f m_position = Vec3f{ 0.0f, 0.0f, 0.0f };
 			Vec3f m_scale = Vec3f{ 1.0f, 1.0f, 1.0f };
 			std::shared_ptr<ActorScript> p_script;
+			std::uint64_t m_transform_version = ++s_transform_counter;
 	};
 }
 
@@ -5,8 +5,8 @@
 
 #include <Core/EventBus.h>
 #include <Renderer/Image.h>
-#include <Renderer/Buffer.h>
 #include <Renderer/Descriptor.h>
+#include <Renderer/BindlessTable.h>
 
 namespace Scop
 {
@@ -26,20 +26,23 @@ namespace Scop
 
 	class Material
 	{
-		friend class Model;
+		friend class ForwardPass;
 
 		public:
-			Material() { m_data_buffer.Init(sizeof(m_data)); SetupEventListener(); }
-			Material(const MaterialTextures& textures) : m_textures(textures) { m_data_buffer.Init(sizeof(m_data)); SetupEventListener(); }
+			Material() { SetupEventListener(); }
+			Material(const MaterialTextures& textures) : m_textures(textures) { SetupEventListener(); }
 
 			inline void SetMaterialData(const MaterialData& data) noexcept { m_data = data; }
+			// Translucent materials are blended over the opaque geometry, back to front
+			inline void SetTranslucent(bool translucent) noexcept { m_translucent = translucent; }
 
-			~Material() { m_data_buffer.Destroy(); }
+			[[nodiscard]] inline bool IsTranslucent() const noexcept { return m_translucent; }
+			// Fully textured, the colors dissolve factors have no effect on the output then
+			[[nodiscard]] inline bool IsStatic() const noexcept { return m_data.dissolve_texture_factor == 1.0f; }
 
-		private:
-			[[nodiscard]] inline bool IsSetInit() const noexcept { return m_set.IsInit(); }
-			[[nodiscard]] inline VkDescriptorSet GetSet(std::size_t frame_index) const noexcept { return m_set.GetSet(frame_index); }
+			~Material() = default;
 
+		private:
 			inline void SetupEventListener()
 			{
 				std::function<void(const EventBase&)> functor = [this](const EventBase& event)
@@ -50,32 +53,39 @@ namespace Scop
 				EventBus::RegisterListener({ functor, "__ScopMaterial" + std::to_string(reinterpret_cast<std::uintptr_t>(this)) });
 			}
 
-			inline void UpdateDescriptorSet(const DescriptorSet& set)
+			// Returns the index of the material in the bindless table of the frame
+			inline std::uint32_t PushToTable(std::size_t frame_index)
 			{
-				m_set = set.Duplicate();
+				if(m_have_been_updated_this_frame)
+					return m_table_index;
+				BindlessTable& table = RenderCore::Get().GetBindlessTable();
+				BindlessMaterialData data{};
+				data.dissolve_texture_factor = m_data.dissolve_texture_factor;
+				data.dissolve_black_white_colors_factor = m_data.dissolve_black_white_colors_factor;
+				data.dissolve_normals_colors_factor = m_data.dissolve_normals_colors_factor;
+				data.albedo_index = table.RegisterTexture(*m_textures.albedo);
+				m_table_index = table.PushMaterial(frame_index, data);
+				m_have_been_updated_this_frame = true;
+				return m_table_index;
 			}
 
-			inline void Bind(std::size_t frame_index, VkCommandBuffer cmd)
+			// Only with sets per material, must be called after the update of the bindless table
+			inline VkDescriptorSet UpdateSet(std::size_t frame_index, VkCommandBuffer cmd)
 			{
-				if(m_have_been_updated_this_frame)
-					return;
-				m_set.SetImage(frame_index, 0, *m_textures.albedo);
-				m_set.SetUniformBuffer(frame_index, 1, m_data_buffer.Get(frame_index));
-				m_set.Update(frame_index, cmd);
-
-				static CPUBuffer buffer(sizeof(MaterialData));
-				std::memcpy(buffer.GetData(), &m_data, buffer.GetSize());
-				m_data_buffer.SetData(buffer, frame_index);
-
-				m_have_been_updated_this_frame = true;
+				BindlessTable& table = RenderCore::Get().GetBindlessTable();
+				if(!m_set.IsInit())
+					m_set = table.CreateMaterialSet();
+				table.UpdateMaterialSet(m_set, frame_index, *m_textures.albedo, cmd);
+				return m_set.GetSet(frame_index);
 			}
 
 		private:
-			UniformBuffer m_data_buffer;
 			MaterialTextures m_textures;
 			MaterialData m_data;
 			DescriptorSet m_set;
+			std::uint32_t m_table_index = 0;
 			bool m_have_been_updated_this_frame = false;
+			bool m_translucent = false;
 	};
 }
 
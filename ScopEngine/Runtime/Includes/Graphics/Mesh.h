@@ -2,11 +2,12 @@
 #define __SCOPE_RENDERER_MESH__
 
 #include <vector>
+#include <algorithm>
 #include <cstdint>
-#include <cstring>
 
 #include <Renderer/Vertex.h>
-#include <Renderer/Buffer.h>
+#include <Renderer/RenderCore.h>
+#include <Renderer/GeometryHeap.h>
 #include <Utils/Buffer.h>
 
 namespace Scop
@@ -16,23 +17,29 @@ namespace Scop
 		public:
 			struct SubMesh
 			{
-				VertexBuffer vbo;
-				IndexBuffer ibo;
+				GeometryHeap::Allocation geometry;
 				std::size_t triangle_count = 0;
+				bool has_transparent_vertices = false; // discarded by the default forward fragment shader
 
 				inline SubMesh(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices)
 				{
-					CPUBuffer vb(vertices.size() * sizeof(Vertex));
-					std::memcpy(vb.GetData(), vertices.data(), vb.GetSize());
-					vbo.Init(vb.GetSize());
-					vbo.SetData(std::move(vb));
-
-					CPUBuffer ib(indices.size() * sizeof(std::uint32_t));
-					std::memcpy(ib.GetData(), indices.data(), ib.GetSize());
-					ibo.Init(ib.GetSize());
-					ibo.SetData(std::move(ib));
-
+					// The heap consumes the data before returning, views of the vectors are enough
+					CPUBuffer vb = CPUBuffer::Wrap(const_cast<Vertex*>(vertices.data()), vertices.size() * sizeof(Vertex));
+					CPUBuffer ib = CPUBuffer::Wrap(const_cast<std::uint32_t*>(indices.data()), indices.size() * sizeof(std::uint32_t));
+					geometry = RenderCore::Get().GetGeometryHeap().Allocate(std::move(vb), std::move(ib));
 					triangle_count = vertices.size() / 3;
+					has_transparent_vertices = std::any_of(vertices.begin(), vertices.end(), [](const Vertex& vertex) { return vertex.color.w == 0.0f; });
+				}
+
+				[[nodiscard]] inline VkDrawIndexedIndirectCommand GetDrawCommand() const noexcept
+				{
+					VkDrawIndexedIndirectCommand command{};
+					command.indexCount = geometry.index_count;
+					command.instanceCount = 1;
+					command.firstIndex = geometry.first_index;
+					command.vertexOffset = static_cast<std::int32_t>(geometry.vertex_offset);
+					command.firstInstance = 0;
+					return command;
 				}
 			};
 
@@ -46,6 +53,7 @@ namespace Scop
 
 			inline void AddSubMesh(SubMesh mesh) { m_sub_meshes.emplace_back(std::move(mesh)); }
 			[[nodiscard]] inline SubMesh& GetSubMesh(std::size_t index) { return m_sub_meshes.at(index); }
+			[[nodiscard]] inline const SubMesh& GetSubMesh(std::size_t index) const { return m_sub_meshes.at(index); }
 
 			~Mesh();
 
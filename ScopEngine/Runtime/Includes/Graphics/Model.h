@@ -22,13 +22,14 @@ namespace Scop
 			Model(std::shared_ptr<Mesh> mesh);
 
 			inline void SetMaterial(std::shared_ptr<Material> material, std::size_t mesh_index) { m_materials[mesh_index] = material; }
-			inline std::size_t GetSubMeshCount() const { return p_mesh->GetSubMeshCount(); }
+			inline std::size_t GetSubMeshCount() const { return (p_mesh ? p_mesh->GetSubMeshCount() : 0); }
 
 			[[nodiscard]] inline std::shared_ptr<Material> GetMaterial(std::size_t mesh_index) { return m_materials[mesh_index]; }
 			[[nodiscard]] inline std::vector<std::shared_ptr<Material>>& GetAllMaterials() { return m_materials; }
 			[[nodiscard]] inline Vec3f GetCenter() const noexcept { return m_center; }
-
-			void Draw(VkCommandBuffer cmd, const DescriptorSet& matrices_set, const class GraphicPipeline& pipeline, DescriptorSet& set, std::size_t& drawcalls, std::size_t& polygondrawn, std::size_t frame_index) const;
+			[[nodiscard]] inline const std::shared_ptr<Mesh>& GetMesh() const noexcept { return p_mesh; }
+			// Falls back on the default material if none was set for this submesh
+			[[nodiscard]] inline Material* GetSubMeshMaterial(std::size_t mesh_index) const { return (m_materials[mesh_index] ? m_materials[mesh_index] : m_materials.back()).get(); }
 
 			~Model() = default;
 
@@ -11,6 +11,7 @@
 #include <Graphics/Sprite.h>
 #include <Renderer/Buffer.h>
 #include <Renderer/Descriptor.h>
+#include <Renderer/TransformBuffer.h>
 #include <Renderer/RenderCore.h>
 #include <Graphics/Cameras/Base.h>
 #include <Renderer/Pipelines/Shader.h>
@@ -21,6 +22,7 @@ namespace Scop
 	struct SceneDescriptor
 	{
 		std::shared_ptr<Shader> fragment_shader;
+		std::shared_ptr<Shader> opaque_fragment_shader; // optional lean variant drawing the static materials
 		std::shared_ptr<BaseCamera> camera;
 		bool render_3D_enabled = true;
 		bool render_2D_enabled = true;
@@ -35,8 +37,8 @@ namespace Scop
 			struct ForwardData
 			{
 				std::shared_ptr<DescriptorSet> matrices_set;
-				std::shared_ptr<DescriptorSet> albedo_set;
-				std::shared_ptr<UniformBuffer> matrices_buffer;
+				std::shared_ptr<TransformBuffer> transforms;
+				std::uint32_t matrices_offset = 0; // in the uniform ring, written each frame
 				bool wireframe = false;
 			};
 
@@ -49,6 +51,7 @@ namespace Scop
 
 			Sprite& CreateSprite(std::shared_ptr<Texture> texture) noexcept;
 			Sprite& CreateSprite(std::string_view name, std::shared_ptr<Texture> texture);
+			Sprite& CreateSprite(const SpriteAtlasRegion& region) noexcept;
 
 			[[nodiscard]] inline Scene& AddChildScene(std::string_view name, SceneDescriptor desc) { return m_scene_children.emplace_back(name, std::move(desc), this); }
 			inline void AddSkybox(std::shared_ptr<CubeTexture> cubemap) { p_skybox = cubemap; }
@@ -60,9 +63,12 @@ namespace Scop
 			[[nodiscard]] inline const std::vector<std::shared_ptr<Sprite>>& GetSprites() const noexcept { return m_sprites; }
 			[[nodiscard]] inline const std::string& GetName() const noexcept { return m_name; }
 			[[nodiscard]] inline GraphicPipeline& GetPipeline() noexcept { return m_pipeline; }
+			[[nodiscard]] inline GraphicPipeline& GetOpaquePipeline() noexcept { return m_opaque_pipeline; }
+			[[nodiscard]] inline GraphicPipeline& GetTranslucentPipeline() noexcept { return m_translucent_pipeline; }
 			[[nodiscard]] inline std::shared_ptr<BaseCamera> GetCamera() const { return m_descriptor.camera; }
 			[[nodiscard]] inline DepthImage& GetDepth() noexcept { return m_depth; }
 			[[nodiscard]] inline std::shared_ptr<Shader> GetFragmentShader() const { return m_descriptor.fragment_shader; }
+			[[nodiscard]] inline std::shared_ptr<Shader> GetOpaqueFragmentShader() const { return m_descriptor.opaque_fragment_shader; }
 			[[nodiscard]] inline std::shared_ptr<CubeTexture> GetSkybox() const { return p_skybox; }
 			[[nodiscard]] inline const SceneDescriptor& GetDescription() const noexcept { return m_descriptor; }
 
@@ -76,6 +82,8 @@ namespace Scop
 
 		private:
 			GraphicPipeline m_pipeline;
+			GraphicPipeline m_opaque_pipeline;
+			GraphicPipeline m_translucent_pipeline;
 			ForwardData m_forward;
 			DepthImage m_depth;
 			SceneDescriptor m_descriptor;
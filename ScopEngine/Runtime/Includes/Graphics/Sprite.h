@@ -7,6 +7,7 @@
 #include <Maths/Vec4.h>
 #include <Core/Script.h>
 #include <Graphics/Mesh.h>
+#include <Graphics/SpriteAtlas.h>
 #include <Renderer/Descriptor.h>
 #include <Renderer/Image.h>
 
@@ -18,6 +19,7 @@ namespace Scop
 
 		public:
 			Sprite(std::shared_ptr<Texture> texture);
+			Sprite(const SpriteAtlasRegion& region);
 
 			inline void AttachScript(std::shared_ptr<SpriteScript> script) { p_script = script; }
 			void Update(NonOwningPtr<class Scene> scene, class Inputs& input, float timestep);
@@ -31,6 +33,7 @@ namespace Scop
 			[[nodiscard]] inline const Vec2f& GetScale() const noexcept { return m_scale; }
 			[[nodiscard]] inline std::shared_ptr<Mesh> GetMesh() const { return p_mesh; }
 			[[nodiscard]] inline std::shared_ptr<Texture> GetTexture() const { return p_texture; }
+			[[nodiscard]] inline const Vec4f& GetUVRect() const noexcept { return m_uv_rect; }
 
 			~Sprite();
 
@@ -55,6 +58,7 @@ namespace Scop
 			std::shared_ptr<class SpriteScript> p_script;
 			std::shared_ptr<Mesh> p_mesh;
 			Vec4f m_color = Vec4f{ 1.0f, 1.0f, 1.0f, 1.0f };
+			Vec4f m_uv_rect = Vec4f{ 0.0f, 0.0f, 1.0f, 1.0f };
 			Vec2ui m_position = Vec2ui{ 0, 0 };
 			Vec2f m_scale = Vec2f{ 1.0f, 1.0f };
 	};
@@ -0,0 +1,57 @@
+#ifndef __SCOP_GRAPHICS_SPRITE_ATLAS__
+#define __SCOP_GRAPHICS_SPRITE_ATLAS__
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include <Maths/Vec2.h>
+#include <Maths/Vec4.h>
+#include <Utils/Buffer.h>
+#include <Renderer/Image.h>
+
+namespace Scop
+{
+	struct SpriteAtlasRegion
+	{
+		std::shared_ptr<Texture> page;
+		Vec4f uv_rect = Vec4f{ 0.0f, 0.0f, 1.0f, 1.0f }; // xy: offset, zw: scale
+		Vec2ui size = Vec2ui{ 0, 0 };
+	};
+
+	// Packs many small RGBA8 images into a few big texture pages at load time
+	class SpriteAtlas
+	{
+		public:
+			SpriteAtlas(std::uint32_t page_size = 2048, std::uint32_t padding = 1);
+
+			// Returns the id used to retrieve the image region once the atlas is built
+			std::size_t AddImage(CPUBuffer pixels, std::uint32_t width, std::uint32_t height);
+			void Build();
+
+			[[nodiscard]] const SpriteAtlasRegion& GetRegion(std::size_t id) const;
+			[[nodiscard]] inline std::size_t GetPagesCount() const noexcept { return m_pages.size(); }
+			[[nodiscard]] inline std::size_t GetImagesCount() const noexcept { return m_images.size(); }
+			[[nodiscard]] inline bool IsBuilt() const noexcept { return m_is_built; }
+
+			~SpriteAtlas() = default;
+
+		private:
+			struct PendingImage
+			{
+				CPUBuffer pixels;
+				std::uint32_t width;
+				std::uint32_t height;
+			};
+
+		private:
+			std::vector<PendingImage> m_images;
+			std::vector<SpriteAtlasRegion> m_regions;
+			std::vector<std::shared_ptr<Texture>> m_pages;
+			std::uint32_t m_page_size;
+			std::uint32_t m_padding;
+			bool m_is_built = false;
+	};
+}
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef __SCOP_BINDLESS_TABLE__
+#define __SCOP_BINDLESS_TABLE__
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include <kvf.h>
+#include <Renderer/Image.h>
+#include <Renderer/Buffer.h>
+#include <Renderer/RenderCore.h>
+#include <Renderer/Descriptor.h>
+
+namespace Scop
+{
+	constexpr std::uint32_t MAX_BINDLESS_TEXTURES = 1024; // must match Assets/Shaders/TextureTables/Bindless/TextureTable.nzsl
+	constexpr std::uint32_t BINDLESS_MATERIALS_BINDING = MAX_BINDLESS_TEXTURES; // the texture array takes the bindings below
+	constexpr std::size_t DEFAULT_BINDLESS_MATERIAL_CAPACITY = 256;
+
+	// Material as read by the forward fragment shaders (std430)
+	struct BindlessMaterialData
+	{
+		float dissolve_texture_factor;
+		float dissolve_black_white_colors_factor;
+		float dissolve_normals_colors_factor;
+		std::uint32_t albedo_index;
+	};
+
+	// Every texture sampled by the forward pass lives in a single descriptor array and materials are entries of a storage
+	// buffer filled each frame, so one set per frame serves every draw. The array is partially bound and updated after bind
+	// when the device supports descriptor indexing, free slots point to a default texture otherwise. Devices that cannot
+	// sample the whole array in a stage fall back to a set per material holding its texture and the materials of the frame.
+	class BindlessTable
+	{
+		public:
+			BindlessTable() = default;
+
+			// Takes the table set layout from the first set of the forward fragment shader
+			void Init(const Shader& shader);
+			void BeginFrame(std::size_t frame_index) noexcept;
+			// Returns the slot of the image in the texture array, registering it if needed
+			[[nodiscard]] std::uint32_t RegisterTexture(Image& image);
+			void ReleaseTexture(const Image& image) noexcept;
+			// Returns the index of the material in the buffer of the frame
+			[[nodiscard]] std::uint32_t PushMaterial(std::size_t frame_index, const BindlessMaterialData& data);
+			// Uploads the materials of the frame and writes the descriptors that changed, must be called before binding the set.
+			// Returns a null handle with sets per material
+			[[nodiscard]] VkDescriptorSet Update(std::size_t frame_index, VkCommandBuffer cmd);
+			void Destroy() noexcept;
+
+			[[nodiscard]] inline DescriptorSet CreateMaterialSet() const { return m_material_set.Duplicate(); }
+			// Must be called after the update of the frame as the materials buffer may be recreated by it
+			void UpdateMaterialSet(DescriptorSet& set, std::size_t frame_index, Image& albedo, VkCommandBuffer cmd);
+
+			[[nodiscard]] inline bool IsPerMaterial() const noexcept { return m_per_material; }
+
+			~BindlessTable() = default;
+
+		private:
+			struct TextureState
+			{
+				VkImageView image_view = VK_NULL_HANDLE;
+				VkSampler sampler = VK_NULL_HANDLE;
+
+				bool operator==(const TextureState&) const noexcept = default;
+			};
+
+		private:
+			std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> m_sets{};
+			std::array<GPUBuffer, MAX_FRAMES_IN_FLIGHT> m_material_buffers;
+			std::array<std::vector<BindlessMaterialData>, MAX_FRAMES_IN_FLIGHT> m_materials;
+			std::array<std::vector<TextureState>, MAX_FRAMES_IN_FLIGHT> m_written_textures; // what each set holds, images may be relocated
+			std::array<VkBuffer, MAX_FRAMES_IN_FLIGHT> m_written_material_buffers{};
+			std::vector<Image*> m_textures; // by slot
+			std::vector<std::uint32_t> m_free_slots;
+			std::unordered_map<const Image*, std::uint32_t> m_texture_slots;
+			std::vector<VkWriteDescriptorSet> m_writes;
+			std::vector<VkDescriptorImageInfo> m_image_infos;
+			Texture m_default_texture;
+			DescriptorSet m_material_set; // duplicated by the materials when they own their sets
+			VkDescriptorPool m_pool = VK_NULL_HANDLE;
+			bool m_partially_bound = false;
+			bool m_per_material = false;
+	};
+}
+
+#endif
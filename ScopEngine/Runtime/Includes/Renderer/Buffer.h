@@ -1,6 +1,9 @@
 #ifndef __SCOP_GPU_BUFFER__
 #define __SCOP_GPU_BUFFER__
 
+#include <utility>
+#include <type_traits>
+
 #include <kvf.h>
 #include <Renderer/Enums.h>
 #include <Core/Logs.h>
@@ -10,18 +13,31 @@
 
 namespace Scop
 {
-	class GPUBuffer
+	constexpr std::size_t DEFAULT_INDIRECT_DRAW_CAPACITY = 256;
+	constexpr VkDeviceSize DEFAULT_UNIFORM_RING_FRAME_SIZE = 4ull * 1024 * 1024;
+
+	class GPUBuffer : public MemoryRelocatable
 	{
 		public:
 			GPUBuffer() = default;
+			GPUBuffer(const GPUBuffer&) = delete;
+			GPUBuffer(GPUBuffer&& buffer) noexcept;
 
 			void Init(BufferType type, VkDeviceSize size, VkBufferUsageFlags usage, CPUBuffer data);
 			void Destroy() noexcept;
 
+			// Blocks until the copy is done
 			bool CopyFrom(const GPUBuffer& buffer) noexcept;
+			// Writes in place when the memory is host visible, goes through the upload context otherwise.
+			// In place writes are not ordered with the GPU, the range must not be used by frames in flight
+			void Write(const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
 
 			void Swap(GPUBuffer& buffer) noexcept;
 
+			bool Relocate(VkCommandBuffer cmd, const MemoryBlock& new_block) override;
+			void ReleaseRelocatedResources() noexcept override;
+			void RetireRelocatedResources() noexcept override;
+
 			[[nodiscard]] inline void* GetMap() const noexcept { return m_memory.map; }
 			[[nodiscard]] inline VkBuffer operator()() const noexcept { return m_buffer; }
 			[[nodiscard]] inline VkBuffer Get() const noexcept { return m_buffer; }
@@ -33,10 +49,14 @@ namespace Scop
 
 			[[nodiscard]] inline bool IsInit() const noexcept { return m_buffer != VK_NULL_HANDLE; }
 
+			GPUBuffer& operator=(const GPUBuffer&) = delete;
+			GPUBuffer& operator=(GPUBuffer&& buffer) noexcept;
+
 			~GPUBuffer() = default;
 
 		protected:
-			void PushToGPU() noexcept;
+			// Only for buffers that are never referenced by descriptor sets, as the VkBuffer changes when relocated
+			void MakeRelocatable() noexcept;
 
 		protected:
 			VkBuffer m_buffer = VK_NULL_HANDLE;
@@ -48,41 +68,85 @@ namespace Scop
 		private:
 			inline static std::size_t s_buffer_count = 0;
 
+			VkBuffer m_relocated_buffer = VK_NULL_HANDLE;
 			VkBufferUsageFlags m_usage = 0;
 			VkMemoryPropertyFlags m_flags = 0;
+			std::uint64_t m_upload_value = 0; // upload batch of the last write going through the upload context
+			bool m_is_relocatable = false;
 	};
 
 	class VertexBuffer : public GPUBuffer
 	{
 		public:
-			inline void Init(std::uint32_t size, VkBufferUsageFlags additional_flags = 0) { GPUBuffer::Init(BufferType::LowDynamic, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | additional_flags, {}); }
-			void SetData(CPUBuffer data);
+			inline void Init(std::uint32_t size, VkBufferUsageFlags additional_flags = 0) { GPUBuffer::Init(BufferType::LowDynamic, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | additional_flags, {}); MakeRelocatable(); }
+			void SetData(CPUBuffer data, std::size_t offset = 0);
 			inline void Bind(VkCommandBuffer cmd) const noexcept { VkDeviceSize offset = 0; RenderCore::Get().vkCmdBindVertexBuffers(cmd, 0, 1, &m_buffer, &offset); }
 	};
 
 	class IndexBuffer : public GPUBuffer
 	{
 		public:
-			inline void Init(std::uint32_t size, VkBufferUsageFlags additional_flags = 0) { GPUBuffer::Init(BufferType::LowDynamic, size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | additional_flags, {}); }
-			void SetData(CPUBuffer data);
+			inline void Init(std::uint32_t size, VkBufferUsageFlags additional_flags = 0) { GPUBuffer::Init(BufferType::LowDynamic, size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | additional_flags, {}); MakeRelocatable(); }
+			void SetData(CPUBuffer data, std::size_t offset = 0);
 			inline void Bind(VkCommandBuffer cmd) const noexcept { RenderCore::Get().vkCmdBindIndexBuffer(cmd, m_buffer, 0, VK_INDEX_TYPE_UINT32); }
 	};
 
-	class UniformBuffer
+	// One persistently mapped uniform buffer with a region per frame in flight. Allocations are linear,
+	// only live for the frame and are read through dynamic uniform buffer descriptors.
+	class UniformRingBuffer
 	{
 		public:
-			void Init(std::uint32_t size);
-			void SetData(CPUBuffer data, std::size_t frame_index);
+			template<typename T>
+			struct Allocation
+			{
+				T* data = nullptr;
+				std::uint32_t offset = 0; // dynamic offset to bind
+			};
+
+		public:
+			UniformRingBuffer() = default;
+
+			void Init(VkDeviceSize frame_size = DEFAULT_UNIFORM_RING_FRAME_SIZE);
+			void BeginFrame(std::size_t frame_index) noexcept;
 			void Destroy() noexcept;
 
-			inline VkDeviceSize GetSize(int i) const noexcept { return m_buffers[i].GetSize(); }
-			inline VkDeviceSize GetOffset(int i) const noexcept { return m_buffers[i].GetOffset(); }
-			inline VkBuffer GetVk(int i) const noexcept { return m_buffers[i].Get(); }
-			inline GPUBuffer& Get(int i) noexcept { return m_buffers[i]; }
+			// The caller writes the data in place, it is read by the frame being recorded
+			template<typename T>
+			[[nodiscard]] inline Allocation<T> Allocate()
+			{
+				static_assert(std::is_trivially_copyable_v<T>, "uniform data must be trivially copyable");
+				auto [data, offset] = AllocateRaw(sizeof(T));
+				return { static_cast<T*>(data), offset };
+			}
+
+			[[nodiscard]] inline GPUBuffer& GetBuffer() noexcept { return m_buffer; }
+
+			~UniformRingBuffer() = default;
+
+		private:
+			[[nodiscard]] std::pair<void*, std::uint32_t> AllocateRaw(VkDeviceSize size);
+
+		private:
+			GPUBuffer m_buffer;
+			VkDeviceSize m_frame_size = 0;
+			VkDeviceSize m_alignment = 0;
+			VkDeviceSize m_frame_begin = 0;
+			VkDeviceSize m_cursor = 0;
+	};
+
+	class IndirectDrawBuffer
+	{
+		public:
+			// Makes room for draw_count commands in the frame buffer, must be called before any draw of the frame
+			void Begin(std::size_t frame_index, std::size_t draw_count);
+			// Records the commands as a single indirect draw if the device allows it, returns the number of draw calls recorded
+			std::size_t Draw(VkCommandBuffer cmd, const VkDrawIndexedIndirectCommand* commands, std::uint32_t count);
+			void Destroy() noexcept;
 
 		private:
 			std::array<GPUBuffer, MAX_FRAMES_IN_FLIGHT> m_buffers;
-			std::array<void*, MAX_FRAMES_IN_FLIGHT> m_maps;
+			std::size_t m_frame_index = 0;
+			std::size_t m_cursor = 0;
 	};
 }
 
@@ -0,0 +1,46 @@
+#ifndef __SCOP_DELETION_QUEUE__
+#define __SCOP_DELETION_QUEUE__
+
+#include <deque>
+#include <cstdint>
+#include <functional>
+
+namespace Scop
+{
+	// Destroys Vulkan objects once the frames in flight at the time they were released have signaled their fence,
+	// so resources can be released while recording without draining the GPU. Uploads and one shot commands recorded
+	// before the release may still be pending after that, the objects also outlive their batches.
+	class DeletionQueue
+	{
+		public:
+			DeletionQueue() = default;
+
+			// Must be called once the frame is not used by the GPU anymore
+			void BeginFrame() noexcept;
+			// Waits for the upload and one shot batches being recorded
+			void Push(std::function<void()> deleter);
+			// Waits for the given batches only, for objects that know which ones target them
+			void Push(std::function<void()> deleter, std::uint64_t upload_value, std::uint64_t one_shot_value);
+			// Runs every pending deleter, the device must be idle
+			void Flush() noexcept;
+
+			[[nodiscard]] inline std::size_t GetPendingCount() const noexcept { return m_pending.size(); }
+
+			~DeletionQueue() = default;
+
+		private:
+			struct PendingDeletion
+			{
+				std::function<void()> deleter;
+				std::uint64_t frame;
+				std::uint64_t upload_value;
+				std::uint64_t one_shot_value;
+			};
+
+		private:
+			std::deque<PendingDeletion> m_pending;
+			std::uint64_t m_frame_counter = 0;
+	};
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <cstdint>
+#include <unordered_map>
 
 #include <kvf.h>
 #include <Renderer/RenderCore.h>
@@ -11,14 +12,74 @@
 
 namespace Scop
 {
+	constexpr std::uint32_t DEFAULT_DESCRIPTOR_POOL_SET_COUNT = 256;
+	constexpr std::uint32_t DEFAULT_TRANSIENT_DESCRIPTOR_POOL_SET_COUNT = 64;
+	constexpr std::size_t MAX_DESCRIPTOR_SET_BINDINGS = 16;
+
+	// What the set of a frame holds for a binding, handles are compared as resources may be recreated or relocated behind the same pointer
+	struct DescriptorState
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkImageView image_view = VK_NULL_HANDLE;
+		VkSampler sampler = VK_NULL_HANDLE;
+		VkImageLayout image_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkDeviceSize range = 0;
+		std::uint32_t version = 0;
+
+		bool operator==(const DescriptorState&) const noexcept = default;
+	};
+
 	struct Descriptor
 	{
+		std::array<DescriptorState, MAX_FRAMES_IN_FLIGHT> written_states{};
 		NonOwningPtr<class GPUBuffer> storage_buffer_ptr;
 		NonOwningPtr<class GPUBuffer> uniform_buffer_ptr;
 		NonOwningPtr<class Image> image_ptr;
+		VkDeviceSize range = VK_WHOLE_SIZE; // dynamic uniform buffers are bound with the size of their data
 		VkDescriptorType type;
 		ShaderType shader_type;
 		std::uint32_t binding;
+		std::uint32_t version = 1; // bumped when another resource is bound
+	};
+
+	// Owns the descriptor pools of the engine. Released sets go back to a free list of their layout once
+	// the frames in flight are done with them, so objects that come and go stop growing the pools.
+	class DescriptorAllocator
+	{
+		public:
+			DescriptorAllocator() = default;
+
+			// Must be called once the frame is not used by the GPU anymore
+			void BeginFrame(std::size_t frame_index) noexcept;
+			[[nodiscard]] VkDescriptorSet Allocate(VkDescriptorSetLayout layout, const std::vector<Descriptor>& descriptors);
+			void Release(VkDescriptorSetLayout layout, VkDescriptorSet set);
+			// Only valid for the frame being recorded, the pools of the frame are reset as a whole
+			[[nodiscard]] VkDescriptorSet AllocateTransient(VkDescriptorSetLayout layout, const std::vector<Descriptor>& descriptors);
+			// Must be called before destroying a layout as its handle may be reused by a new one
+			void ForgetLayout(VkDescriptorSetLayout layout) noexcept;
+			void Destroy() noexcept;
+
+			~DescriptorAllocator() = default;
+
+		private:
+			struct PoolList
+			{
+				std::vector<VkDescriptorPool> pools;
+				std::size_t current = 0; // pools before it are full
+			};
+
+		private:
+			VkDescriptorSet AllocateFromPools(PoolList& list, std::uint32_t set_count, VkDescriptorSetLayout layout, const std::vector<Descriptor>& descriptors);
+			VkDescriptorPool CreatePool(std::uint32_t set_count, const std::vector<Descriptor>& descriptors);
+
+		private:
+			std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> m_free_sets;
+			std::unordered_map<VkDescriptorType, std::uint64_t> m_descriptor_usage; // descriptors allocated per type, used to size new pools
+			std::unordered_map<VkDescriptorSetLayout, std::uint64_t> m_layout_generations; // bumped when a layout is forgotten, its handle may be reused
+			std::array<PoolList, MAX_FRAMES_IN_FLIGHT> m_transient_pools;
+			PoolList m_pools;
+			std::uint64_t m_set_usage = 0;
+			std::size_t m_frame_index = 0;
 	};
 
 	class DescriptorSet
@@ -26,25 +87,31 @@ namespace Scop
 		public:
 			DescriptorSet() { m_set.fill(VK_NULL_HANDLE); }
 			DescriptorSet(const ShaderSetLayout& layout, VkDescriptorSetLayout vklayout, ShaderType shader_type);
+			DescriptorSet(const DescriptorSet&) = delete;
+			DescriptorSet(DescriptorSet&& set) noexcept;
 
 			void SetImage(std::size_t i, std::uint32_t binding, class Image& image);
 			void SetStorageBuffer(std::size_t i, std::uint32_t binding, class GPUBuffer& buffer);
-			void SetUniformBuffer(std::size_t i, std::uint32_t binding, class GPUBuffer& buffer);
+			void SetUniformBuffer(std::size_t i, std::uint32_t binding, class GPUBuffer& buffer, VkDeviceSize range = VK_WHOLE_SIZE);
 			void Update(std::size_t i, VkCommandBuffer cmd = VK_NULL_HANDLE) noexcept;
 
 			[[nodiscard]] inline VkDescriptorSet GetSet(std::size_t i) const noexcept { return m_set[i]; }
 			[[nodiscard]] inline DescriptorSet Duplicate() const { return DescriptorSet{ m_set_layout, m_descriptors }; }
 			[[nodiscard]] inline bool IsInit() const noexcept { return m_set[0] != VK_NULL_HANDLE; }
 
-			~DescriptorSet() = default;
+			DescriptorSet& operator=(const DescriptorSet&) = delete;
+			DescriptorSet& operator=(DescriptorSet&& set) noexcept;
+
+			~DescriptorSet();
 
 		private:
 			DescriptorSet(VkDescriptorSetLayout layout, const std::vector<Descriptor>& descriptors);
+			void Release() noexcept;
 
 		private:
 			std::vector<Descriptor> m_descriptors;
 			std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> m_set;
-			VkDescriptorSetLayout m_set_layout;
+			VkDescriptorSetLayout m_set_layout = VK_NULL_HANDLE;
 	};
 }
 
@@ -26,6 +26,17 @@ namespace Scop
 		EndEnum
 	};
 	constexpr std::size_t ImageTypeCount = static_cast<std::size_t>(ImageType::EndEnum);
+
+	// Linear (buffers, linear images) and optimal (tiled images) resources live in separate chunks
+	// so that bufferImageGranularity never has to be taken into account inside a chunk
+	enum class MemoryPool
+	{
+		Linear = 0,
+		Optimal,
+
+		EndEnum
+	};
+	constexpr std::size_t MemoryPoolCount = static_cast<std::size_t>(MemoryPool::EndEnum);
 }
 
 #endif
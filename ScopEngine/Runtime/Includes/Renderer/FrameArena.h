@@ -0,0 +1,55 @@
+#ifndef __SCOP_FRAME_ARENA__
+#define __SCOP_FRAME_ARENA__
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <memory_resource>
+
+#include <Renderer/RenderCore.h>
+
+namespace Scop
+{
+	constexpr std::size_t DEFAULT_FRAME_ARENA_SIZE = 256 * 1024;
+
+	// Linear allocator for CPU data that does not outlive the frame, with a region per frame in flight.
+	// Deallocations are no-ops, the region of a frame is rewound as a whole when the frame begins again.
+	// Usable by std::pmr containers:
+	//     std::pmr::vector<Foo> foos(&RenderCore::Get().GetFrameArena());
+	class FrameArena : public std::pmr::memory_resource
+	{
+		public:
+			FrameArena() = default;
+
+			void Init(std::size_t region_size = DEFAULT_FRAME_ARENA_SIZE);
+			// Must be called once the frame is not used anymore, everything allocated from its region is dropped
+			void BeginFrame(std::size_t frame_index) noexcept;
+			void Destroy() noexcept;
+
+			[[nodiscard]] inline std::size_t GetUsedSize() const noexcept { return m_regions[m_frame_index].offset + m_regions[m_frame_index].overflow_size; }
+
+			~FrameArena() override = default;
+
+		private:
+			struct Region
+			{
+				std::unique_ptr<std::byte[]> memory;
+				std::vector<std::unique_ptr<std::byte[]>> overflow; // allocations that did not fit, merged into memory at the next rewind
+				std::size_t size = 0;
+				std::size_t offset = 0;
+				std::size_t overflow_size = 0;
+			};
+
+		private:
+			void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+			inline void do_deallocate(void*, std::size_t, std::size_t) override {}
+			inline bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+		private:
+			std::array<Region, MAX_FRAMES_IN_FLIGHT> m_regions;
+			std::size_t m_frame_index = 0;
+	};
+}
+
+#endif
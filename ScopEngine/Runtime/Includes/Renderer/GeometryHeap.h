@@ -0,0 +1,83 @@
+#ifndef __SCOP_GEOMETRY_HEAP__
+#define __SCOP_GEOMETRY_HEAP__
+
+#include <map>
+#include <deque>
+#include <cstdint>
+#include <optional>
+
+#include <kvf.h>
+#include <Renderer/Buffer.h>
+#include <Utils/Buffer.h>
+
+namespace Scop
+{
+	constexpr std::uint32_t DEFAULT_GEOMETRY_PAGE_VERTEX_COUNT = 256 * 1024;
+	constexpr std::uint32_t DEFAULT_GEOMETRY_PAGE_INDEX_COUNT = 1024 * 1024;
+
+	// Static geometry is sub-allocated from a few large vertex and index buffers (pages)
+	// so meshes sharing a page are drawn without rebinding buffers.
+	// Indices are relative to the first vertex of their allocation, draws use vertex_offset.
+	class GeometryHeap
+	{
+		public:
+			struct Allocation
+			{
+				std::uint32_t page = 0;
+				std::uint32_t vertex_offset = 0;
+				std::uint32_t vertex_count = 0;
+				std::uint32_t first_index = 0;
+				std::uint32_t index_count = 0;
+
+				[[nodiscard]] inline bool IsValid() const noexcept { return vertex_count != 0; }
+			};
+
+		public:
+			GeometryHeap() = default;
+
+			// vertices and indices are tightly packed Vertex and std::uint32_t arrays
+			[[nodiscard]] Allocation Allocate(CPUBuffer vertices, CPUBuffer indices);
+			// The ranges are only reused once the frames in flight at that time are done reading them
+			void Free(Allocation& allocation) noexcept;
+
+			void Bind(VkCommandBuffer cmd, std::uint32_t page) const noexcept;
+
+			void Destroy() noexcept;
+
+			[[nodiscard]] inline std::size_t GetPageCount() const noexcept { return m_pages.size(); }
+
+			~GeometryHeap() = default;
+
+		private:
+			// First fit over free ranges, adjacent ranges are merged back when freed
+			class RangeAllocator
+			{
+				public:
+					RangeAllocator() = default;
+					void Init(std::uint32_t capacity);
+					[[nodiscard]] std::optional<std::uint32_t> Allocate(std::uint32_t count) noexcept;
+					void Free(std::uint32_t offset, std::uint32_t count) noexcept;
+					~RangeAllocator() = default;
+
+				private:
+					std::map<std::uint32_t, std::uint32_t> m_free_ranges; // offset -> count
+			};
+
+			struct Page
+			{
+				VertexBuffer vbo;
+				IndexBuffer ibo;
+				RangeAllocator vertices;
+				RangeAllocator indices;
+			};
+
+		private:
+			Page& CreatePage(std::uint32_t vertex_count, std::uint32_t index_count);
+			void Release(const Allocation& allocation) noexcept;
+
+		private:
+			std::deque<Page> m_pages; // deque so that pages never move, buffers are known by address when relocatable
+	};
+}
+
+#endif
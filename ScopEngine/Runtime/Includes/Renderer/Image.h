@@ -14,7 +14,7 @@
 
 namespace Scop
 {
-	class Image
+	class Image : public MemoryRelocatable
 	{
 		public:
 			Image() = default;
@@ -38,6 +38,10 @@ namespace Scop
 			void DestroyImageView() noexcept;
 			virtual void Destroy() noexcept;
 
+			bool Relocate(VkCommandBuffer cmd, const MemoryBlock& new_block) override;
+			void ReleaseRelocatedResources() noexcept override;
+			void RetireRelocatedResources() noexcept override;
+
 			[[nodiscard]] inline VkImage Get() const noexcept { return m_image; }
 			[[nodiscard]] inline VkImage operator()() const noexcept { return m_image; }
 			[[nodiscard]] inline VkDeviceMemory GetDeviceMemory() const noexcept { return m_memory.memory; }
@@ -55,20 +59,30 @@ namespace Scop
 
 			virtual ~Image() = default;
 
+		protected:
+			// Uploads through the upload context, the image is in final_layout once the upload batch is submitted
+			void Upload(const void* data, VkDeviceSize size, const VkBufferImageCopy* regions, std::uint32_t regions_count, VkImageLayout final_layout);
+			// Only for sampled color images, the image and its view change when relocated
+			void MakeRelocatable() noexcept;
+
 		private:
 			inline static std::size_t s_image_count = 0;
 
 			MemoryBlock m_memory = NULL_MEMORY_BLOCK;
 			VkImage m_image = VK_NULL_HANDLE;
 			VkImageView m_image_view = VK_NULL_HANDLE;
+			VkImage m_relocated_image = VK_NULL_HANDLE;
+			VkImageView m_relocated_image_view = VK_NULL_HANDLE;
 			VkSampler m_sampler = VK_NULL_HANDLE;
 			VkFormat m_format;
 			VkImageTiling m_tiling;
+			VkImageUsageFlags m_usage = 0;
 			VkImageLayout m_layout = VK_IMAGE_LAYOUT_UNDEFINED;
 			ImageType m_type;
 			std::uint32_t m_width = 0;
 			std::uint32_t m_height = 0;
 			bool m_is_multisampled = false;
+			bool m_is_relocatable = false;
 	};
 
 	class DepthImage : public Image
@@ -90,35 +104,29 @@ namespace Scop
 	{
 		public:
 			Texture() = default;
+			Texture(const Texture&) = delete;
 			Texture(CPUBuffer pixels, std::uint32_t width, std::uint32_t height, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB, bool is_multisampled = false)
 			{
 				Init(std::move(pixels), width, height, format, is_multisampled);
 			}
 			inline void Init(CPUBuffer pixels, std::uint32_t width, std::uint32_t height, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB, bool is_multisampled = false)
 			{
-				Image::Init(ImageType::Color, width, height, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, is_multisampled);
+				Image::Init(ImageType::Color, width, height, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, is_multisampled);
 				Image::CreateImageView(VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT);
 				Image::CreateSampler();
 				if(pixels)
 				{
-					TransitionLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-					GPUBuffer staging_buffer;
-					std::size_t size = width * height * kvfFormatSize(format);
-					staging_buffer.Init(BufferType::Staging, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, pixels);
-					VkCommandBuffer cmd = kvfCreateCommandBuffer(RenderCore::Get().GetDevice());
-					kvfBeginCommandBuffer(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-					kvfCopyBufferToImage(cmd, Image::Get(), staging_buffer.Get(), staging_buffer.GetOffset(), VK_IMAGE_ASPECT_COLOR_BIT, { width, height, 1 });
-					RenderCore::Get().vkEndCommandBuffer(cmd);
-					VkFence fence = kvfCreateFence(RenderCore::Get().GetDevice());
-					kvfSubmitSingleTimeCommandBuffer(RenderCore::Get().GetDevice(), cmd, KVF_GRAPHICS_QUEUE, fence);
-					kvfDestroyFence(RenderCore::Get().GetDevice(), fence);
-					staging_buffer.Destroy();
+					VkBufferImageCopy region{};
+					region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+					region.imageSubresource.layerCount = 1;
+					region.imageExtent = { width, height, 1 };
+					Upload(pixels.GetData(), width * height * kvfFormatSize(format), &region, 1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+					MakeRelocatable();
 				}
-				if(!pixels)
-					TransitionLayout(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 				else
-					TransitionLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+					TransitionLayout(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 			}
+			Texture& operator=(const Texture&) = delete;
 			~Texture() override { Destroy(); }
 	};
 
@@ -3,9 +3,12 @@
 
 #include <kvf.h>
 #include <algorithm>
+#include <cstdint>
 
 namespace Scop
 {
+	constexpr std::uint32_t NULL_MEMORY_BLOCK_HANDLE = UINT32_MAX;
+
 	class MemoryBlock
 	{
 		friend class MemoryChunk;
@@ -18,7 +21,7 @@ namespace Scop
 				return  memory == rhs.memory &&
 						offset == rhs.offset &&
 						size == rhs.size &&
-						free == rhs.free &&
+						handle == rhs.handle &&
 						map == rhs.map;
 			}
 
@@ -28,7 +31,7 @@ namespace Scop
 				std::swap(offset, rhs.offset);
 				std::swap(size, rhs.size);
 				std::swap(map, rhs.map);
-				std::swap(free, rhs.free);
+				std::swap(handle, rhs.handle);
 			}
 
 			~MemoryBlock() = default;
@@ -38,12 +41,27 @@ namespace Scop
 			VkDeviceSize offset = 0;
 			VkDeviceSize size = 0;
 			void* map = nullptr; // useless if it's a GPU allocation
-		
+
 		private:
-			bool free = false;
+			std::uint32_t handle = NULL_MEMORY_BLOCK_HANDLE; // index of the block inside its chunk
 	};
 
-	constexpr MemoryBlock NULL_MEMORY_BLOCK{}; 
+	constexpr MemoryBlock NULL_MEMORY_BLOCK{};
+
+	// Implemented by owners of memory blocks that can be moved by the defragmenter
+	class MemoryRelocatable
+	{
+		public:
+			// Records the copy of the resource into new_block; the owner must use the new resource right away
+			virtual bool Relocate(VkCommandBuffer cmd, const MemoryBlock& new_block) = 0;
+			// Called once the copy is done and no frame in flight can use the old resource anymore
+			virtual void ReleaseRelocatedResources() noexcept = 0;
+			// Called when the relocation is cancelled, frames in flight may still use the old resource
+			virtual void RetireRelocatedResources() noexcept = 0;
+
+		protected:
+			~MemoryRelocatable() = default;
+	};
 }
 
 #endif
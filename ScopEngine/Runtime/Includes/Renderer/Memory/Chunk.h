@@ -1,35 +1,106 @@
 #ifndef __SCOP_VULKAN_MEMORY_CHUNK__
 #define __SCOP_VULKAN_MEMORY_CHUNK__
 
+#include <array>
 #include <vector>
 #include <cstdint>
 #include <optional>
 
+#include <Renderer/Enums.h>
 #include <Renderer/Memory/Block.h>
 
 namespace Scop
 {
+	struct MemoryStatistics
+	{
+		VkDeviceSize allocated_bytes = 0; // size of the device memory objects
+		VkDeviceSize used_bytes = 0;
+		VkDeviceSize largest_free_block = 0;
+		std::size_t chunk_count = 0;
+		std::size_t block_count = 0;
+		std::size_t free_block_count = 0;
+		std::size_t allocations_per_frame = 0;
+		std::size_t deallocations_per_frame = 0;
+
+		void Merge(const MemoryStatistics& rhs) noexcept;
+		// 0 when all the free memory is contiguous, close to 1 when it is scattered in small blocks
+		[[nodiscard]] float GetFragmentation() const noexcept;
+	};
+
+	// Two-level segregated fit allocator, allocations and deallocations are O(1)
 	class MemoryChunk
 	{
 		public:
-			MemoryChunk(VkDevice device, VkPhysicalDevice physical, VkDeviceSize size, std::int32_t memory_type_index);
+			MemoryChunk(VkDevice device, VkPhysicalDevice physical, VkDeviceSize size, std::int32_t memory_type_index, MemoryPool pool, bool dedicated = false, VkImage dedicated_image = VK_NULL_HANDLE);
 
 			[[nodiscard]] std::optional<MemoryBlock> Allocate(VkDeviceSize size, VkDeviceSize alignment);
 			void Deallocate(const MemoryBlock& block);
+			void SetOwner(const MemoryBlock& block, MemoryRelocatable* owner) noexcept;
+			// Calls func(block, alignment, owner) for every allocated block of the chunk
+			template<typename F>
+			void ForEachUsedBlock(F&& func) const;
+			// Calls func(offset, size, free) for every block of the chunk, in address order
+			template<typename F>
+			void ForEachBlockRange(F&& func) const;
+			void AccumulateStatistics(MemoryStatistics& stats) const noexcept;
+			[[nodiscard]] inline bool IsValid() const noexcept { return m_memory != VK_NULL_HANDLE; }
 			[[nodiscard]] inline bool Has(const MemoryBlock& block) const noexcept { return block.memory == m_memory; }
 			[[nodiscard]] inline std::int32_t GetMemoryTypeIndex() const noexcept { return m_memory_type_index; }
+			[[nodiscard]] inline VkDeviceSize GetSize() const noexcept { return m_size; }
+			[[nodiscard]] inline VkDeviceSize GetUsedSize() const noexcept { return m_used_size; }
+			[[nodiscard]] inline bool IsEmpty() const noexcept { return m_used_size == 0; }
+			[[nodiscard]] inline bool IsDedicated() const noexcept { return m_dedicated; }
+			[[nodiscard]] inline MemoryPool GetPool() const noexcept { return m_pool; }
 
 			~MemoryChunk();
 
+		private:
+			static constexpr std::uint32_t SL_INDEX_LOG2 = 5;
+			static constexpr std::uint32_t SL_INDEX_COUNT = 1 << SL_INDEX_LOG2;
+			static constexpr std::uint32_t FL_INDEX_COUNT = 64 - SL_INDEX_LOG2 + 1;
+			static constexpr VkDeviceSize SMALL_BLOCK_SIZE = 1 << SL_INDEX_LOG2;
+
+			struct Node
+			{
+				VkDeviceSize offset = 0;
+				VkDeviceSize size = 0;
+				std::uint32_t prev_physical = NULL_MEMORY_BLOCK_HANDLE;
+				std::uint32_t next_physical = NULL_MEMORY_BLOCK_HANDLE;
+				std::uint32_t prev_free = NULL_MEMORY_BLOCK_HANDLE;
+				std::uint32_t next_free = NULL_MEMORY_BLOCK_HANDLE;
+				VkDeviceSize alignment = 1;
+				MemoryRelocatable* owner = nullptr;
+				bool free = false;
+			};
+
+		private:
+			static void MappingInsert(VkDeviceSize size, std::uint32_t& fl, std::uint32_t& sl) noexcept;
+			static void MappingSearch(VkDeviceSize size, std::uint32_t& fl, std::uint32_t& sl) noexcept;
+
+			[[nodiscard]] std::uint32_t FindFreeNode(VkDeviceSize size) const noexcept;
+			[[nodiscard]] std::uint32_t CreateNode(VkDeviceSize offset, VkDeviceSize size);
+			void ReleaseNode(std::uint32_t handle) noexcept;
+			void InsertFreeNode(std::uint32_t handle) noexcept;
+			void RemoveFreeNode(std::uint32_t handle) noexcept;
+
 		protected:
-			std::vector<MemoryBlock> m_blocks;
+			std::vector<Node> m_nodes;
+			std::vector<std::uint32_t> m_recycled_nodes;
+			std::array<std::array<std::uint32_t, SL_INDEX_COUNT>, FL_INDEX_COUNT> m_free_lists;
+			std::array<std::uint32_t, FL_INDEX_COUNT> m_sl_bitmaps;
+			std::uint64_t m_fl_bitmap = 0;
 			VkDevice m_device = VK_NULL_HANDLE;
 			VkPhysicalDevice m_physical = VK_NULL_HANDLE;
 			VkDeviceMemory m_memory = VK_NULL_HANDLE;
 			void* p_map = nullptr;
 			VkDeviceSize m_size = 0;
+			VkDeviceSize m_used_size = 0;
 			std::int32_t m_memory_type_index;
+			MemoryPool m_pool;
+			bool m_dedicated;
 	};
 }
 
+#include <Renderer/Memory/Chunk.inl>
+
 #endif
@@ -0,0 +1,37 @@
+#pragma once
+#include <Renderer/Memory/Chunk.h>
+
+namespace Scop
+{
+	template<typename F>
+	void MemoryChunk::ForEachUsedBlock(F&& func) const
+	{
+		for(std::uint32_t i = 0; i < m_nodes.size(); i++)
+		{
+			const Node& node = m_nodes[i];
+			if(node.free || node.size == 0)
+				continue;
+			MemoryBlock block;
+			block.memory = m_memory;
+			block.offset = node.offset;
+			block.size = node.size;
+			block.handle = i;
+			if(p_map != nullptr)
+				block.map = reinterpret_cast<void*>(reinterpret_cast<std::uintptr_t>(p_map) + block.offset);
+			func(block, node.alignment, node.owner);
+		}
+	}
+
+	template<typename F>
+	void MemoryChunk::ForEachBlockRange(F&& func) const
+	{
+		std::uint32_t handle = NULL_MEMORY_BLOCK_HANDLE;
+		for(std::uint32_t i = 0; i < m_nodes.size() && handle == NULL_MEMORY_BLOCK_HANDLE; i++)
+		{
+			if(m_nodes[i].size != 0 && m_nodes[i].prev_physical == NULL_MEMORY_BLOCK_HANDLE)
+				handle = i;
+		}
+		for(; handle != NULL_MEMORY_BLOCK_HANDLE; handle = m_nodes[handle].next_physical)
+			func(m_nodes[handle].offset, m_nodes[handle].size, m_nodes[handle].free);
+	}
+}
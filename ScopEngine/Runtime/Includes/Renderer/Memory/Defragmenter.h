@@ -0,0 +1,54 @@
+#ifndef __SCOP_VULKAN_MEMORY_DEFRAGMENTER__
+#define __SCOP_VULKAN_MEMORY_DEFRAGMENTER__
+
+#include <vector>
+#include <cstdint>
+
+#include <Renderer/Memory/Block.h>
+
+namespace Scop
+{
+	// Incrementally empties sparse chunks by moving their blocks to other chunks of the same memory type.
+	// At most one batch of GPU copies is in flight; its old resources are released a few frames later.
+	class DeviceDefragmenter
+	{
+		public:
+			DeviceDefragmenter(class DeviceAllocator& allocator) : m_allocator(allocator) {}
+
+			// Must be called once per frame, after the fence of the frame has been waited on
+			void Update();
+			void CancelRelocation(MemoryRelocatable* owner) noexcept;
+			// To be called when relocatable owners are moved in memory
+			void SwapOwners(MemoryRelocatable* lhs, MemoryRelocatable* rhs) noexcept;
+			void Destroy() noexcept;
+
+			inline void SetEnabled(bool enabled) noexcept { m_enabled = enabled; }
+			[[nodiscard]] inline bool IsEnabled() const noexcept { return m_enabled; }
+			[[nodiscard]] inline VkDeviceSize GetRelocatedBytes() const noexcept { return m_relocated_bytes; }
+
+			~DeviceDefragmenter() = default;
+
+		private:
+			struct Relocation
+			{
+				MemoryRelocatable* owner;
+				MemoryBlock old_block;
+			};
+
+		private:
+			void Retire() noexcept;
+			void StartRelocations();
+
+		private:
+			class DeviceAllocator& m_allocator;
+			std::vector<Relocation> m_relocations;
+			VkCommandBuffer m_cmd = VK_NULL_HANDLE;
+			VkFence m_fence = VK_NULL_HANDLE;
+			std::uint64_t m_frame = 0;
+			std::uint64_t m_retire_frame = 0;
+			VkDeviceSize m_relocated_bytes = 0;
+			bool m_enabled = true;
+	};
+}
+
+#endif
@@ -1,34 +1,98 @@
 #ifndef __SCOP_VULKAN_MEMORY_DEVICE_ALLOCATOR__
 #define __SCOP_VULKAN_MEMORY_DEVICE_ALLOCATOR__
 
+#include <array>
 #include <vector>
 #include <memory>
+#include <string>
 #include <cstdint>
+#include <optional>
+#include <filesystem>
 
 #include <Renderer/Memory/Block.h>
 #include <Renderer/Memory/Chunk.h>
+#include <Renderer/Memory/Defragmenter.h>
 
 namespace Scop
 {
+	enum class EmptyChunkPolicy
+	{
+		Release, // frees a chunk as soon as it gets empty
+		KeepOne, // keeps at most one empty chunk per memory type to avoid allocation ping-pong
+		Retain,  // never frees empty chunks until ReleaseEmptyChunks is called
+	};
+
+	struct MemoryBudget
+	{
+		VkDeviceSize usage = 0;
+		VkDeviceSize budget = 0;
+	};
+
 	class DeviceAllocator
 	{
+		friend class DeviceDefragmenter;
+
 		public:
 			DeviceAllocator() = default;
 
-			inline void AttachToDevice(VkDevice device, VkPhysicalDevice physical) noexcept { m_device = device; m_physical = physical; }
-			inline void DetachFromDevice() noexcept { m_chunks.clear(); m_device = VK_NULL_HANDLE; m_physical = VK_NULL_HANDLE; }
+			void AttachToDevice(VkDevice device, VkPhysicalDevice physical, bool has_memory_budget = false, bool has_dedicated_allocation = false) noexcept;
+			void DetachFromDevice() noexcept;
 			[[nodiscard]] inline std::size_t GetAllocationsCount() const noexcept { return m_allocations_count; }
 
-			[[nodiscard]] MemoryBlock Allocate(VkDeviceSize size, VkDeviceSize alignment, std::int32_t memory_type_index, bool dedicated_chunk = false);
+			// dedicated_image is only used for dedicated chunks, to hint the driver through VK_KHR_dedicated_allocation
+			[[nodiscard]] MemoryBlock Allocate(VkDeviceSize size, VkDeviceSize alignment, std::int32_t memory_type_index, MemoryPool pool = MemoryPool::Linear, bool dedicated_chunk = false, VkImage dedicated_image = VK_NULL_HANDLE);
 			void Deallocate(const MemoryBlock& block);
+			// Lets the defragmenter move the block, the owner must call DeviceDefragmenter::CancelRelocation before freeing it
+			void SetRelocatable(const MemoryBlock& block, MemoryRelocatable* owner) noexcept;
+			[[nodiscard]] inline DeviceDefragmenter& GetDefragmenter() noexcept { return m_defragmenter; }
+
+			inline void SetEmptyChunkPolicy(EmptyChunkPolicy policy) noexcept { m_empty_chunk_policy = policy; }
+			[[nodiscard]] inline EmptyChunkPolicy GetEmptyChunkPolicy() const noexcept { return m_empty_chunk_policy; }
+			void ReleaseEmptyChunks(std::int32_t heap_index = -1);
+
+			[[nodiscard]] MemoryBudget GetHeapBudget(std::uint32_t heap_index) const noexcept;
+			[[nodiscard]] inline std::uint32_t GetHeapCount() const noexcept { return m_memory_properties.memoryHeapCount; }
+			[[nodiscard]] inline bool HasMemoryBudgetExtension() const noexcept { return m_has_memory_budget; }
+			[[nodiscard]] inline bool HasDedicatedAllocationExtension() const noexcept { return m_has_dedicated_allocation; }
+
+			// Must be called once per frame, rolls the allocation and free counters
+			void NewFrame() noexcept;
+			[[nodiscard]] MemoryStatistics GetMemoryTypeStatistics(std::uint32_t memory_type_index) const noexcept;
+			[[nodiscard]] MemoryStatistics GetHeapStatistics(std::uint32_t heap_index) const noexcept;
+			[[nodiscard]] MemoryStatistics GetTotalStatistics() const noexcept;
+			[[nodiscard]] inline std::uint32_t GetMemoryTypeCount() const noexcept { return m_memory_properties.memoryTypeCount; }
+			[[nodiscard]] inline std::uint32_t GetMemoryTypeHeapIndex(std::uint32_t memory_type_index) const noexcept { return m_memory_properties.memoryTypes[memory_type_index].heapIndex; }
+			[[nodiscard]] inline const std::vector<std::unique_ptr<MemoryChunk>>& GetChunks() const noexcept { return m_chunks; }
+
+			// Full block map of every chunk, also written when the device runs out of memory
+			[[nodiscard]] std::string BuildJsonReport() const;
+			bool DumpJsonReport(const std::filesystem::path& path) const;
 
 			~DeviceAllocator() = default;
 
+		private:
+			[[nodiscard]] std::optional<MemoryBlock> AllocateInExistingChunks(VkDeviceSize size, VkDeviceSize alignment, std::int32_t memory_type_index, MemoryPool pool, const MemoryChunk* excluded = nullptr, bool allow_empty_chunks = true);
+			[[nodiscard]] VkDeviceSize ComputeChunkSize(std::int32_t memory_type_index, MemoryPool pool, VkDeviceSize min_size) const noexcept;
+			void ReleaseChunk(std::size_t index) noexcept;
+			[[nodiscard]] std::unique_ptr<MemoryChunk> CreateChunk(VkDeviceSize size, std::int32_t memory_type_index, MemoryPool pool, bool dedicated, VkImage dedicated_image);
+
 		private:
 			std::vector<std::unique_ptr<MemoryChunk>> m_chunks;
+			DeviceDefragmenter m_defragmenter{ *this };
+			std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_heap_usage;
+			std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_preferred_chunk_sizes;
+			std::array<std::size_t, VK_MAX_MEMORY_TYPES> m_frame_allocations;
+			std::array<std::size_t, VK_MAX_MEMORY_TYPES> m_frame_deallocations;
+			std::array<std::size_t, VK_MAX_MEMORY_TYPES> m_last_frame_allocations;
+			std::array<std::size_t, VK_MAX_MEMORY_TYPES> m_last_frame_deallocations;
+			VkPhysicalDeviceMemoryProperties m_memory_properties{};
 			VkDevice m_device = VK_NULL_HANDLE;
 			VkPhysicalDevice m_physical = VK_NULL_HANDLE;
+			VkDeviceSize m_buffer_image_granularity = 1;
 			std::size_t m_allocations_count = 0;
+			EmptyChunkPolicy m_empty_chunk_policy = EmptyChunkPolicy::KeepOne;
+			bool m_has_memory_budget = false;
+			bool m_has_dedicated_allocation = false;
 	};
 }
 
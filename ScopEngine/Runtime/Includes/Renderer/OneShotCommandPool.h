@@ -0,0 +1,53 @@
+#ifndef __SCOP_ONE_SHOT_COMMAND_POOL__
+#define __SCOP_ONE_SHOT_COMMAND_POOL__
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <kvf.h>
+
+namespace Scop
+{
+	// Resettable command buffers and fences for short graphics work recorded outside of frames, like layout transitions.
+	// Everything recorded between two flushes goes in the same command buffer and is submitted at once,
+	// before the uploads flushed with it and before any frame submitted afterwards.
+	class OneShotCommandPool
+	{
+		public:
+			OneShotCommandPool() = default;
+
+			void Init();
+			void Destroy() noexcept;
+
+			// Command buffer of the batch being recorded, begins one if needed
+			[[nodiscard]] VkCommandBuffer Get();
+			// Submits the batch being recorded
+			void Flush();
+			// Submits the batch being recorded and waits for every batch
+			void WaitIdle();
+			[[nodiscard]] bool IsComplete(std::uint64_t value);
+			// Value of the batch being recorded, or of the last submitted one
+			[[nodiscard]] inline std::uint64_t GetCurrentBatchValue() const noexcept { return m_next_value - 1; }
+
+			~OneShotCommandPool() = default;
+
+		private:
+			struct Batch
+			{
+				VkCommandBuffer cmd = VK_NULL_HANDLE;
+				VkFence fence = VK_NULL_HANDLE;
+				std::uint64_t value = 0;
+				bool in_flight = false;
+			};
+
+		private:
+			std::vector<Batch> m_batches;
+			VkCommandPool m_pool = VK_NULL_HANDLE;
+			std::size_t m_current = 0;
+			std::uint64_t m_next_value = 1;
+			bool m_recording = false;
+	};
+}
+
+#endif
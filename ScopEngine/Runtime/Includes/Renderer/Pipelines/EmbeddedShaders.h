@@ -0,0 +1,15 @@
+#ifndef __SCOP_EMBEDDED_SHADERS__
+#define __SCOP_EMBEDDED_SHADERS__
+
+#include <span>
+#include <cstdint>
+#include <string_view>
+
+namespace Scop
+{
+	// SPIR-V of the engine shaders baked into the binary by the shaders target, by file name without extension.
+	// Empty for names that are not engine shaders
+	[[nodiscard]] std::span<const std::uint32_t> GetEmbeddedShader(std::string_view name) noexcept;
+}
+
+#endif
@@ -24,6 +24,8 @@ namespace Scop
 		VkPolygonMode mode = VK_POLYGON_MODE_FILL;
 		bool no_vertex_inputs = false;
 		bool depth_test_equal = false;
+		bool depth_write = true;
+		bool blending = true; // alpha blending, to turn off for opaque geometry
 		bool clear_color_attachments = true;
 	};
 
@@ -37,14 +39,16 @@ namespace Scop
 			void EndPipeline(VkCommandBuffer command_buffer) noexcept override;
 			void Destroy() noexcept;
 
-			[[nodiscard]] inline VkPipeline GetPipeline() const override { return m_pipeline; }
+			// Fallback variant while the requested one is still compiling in the background
+			[[nodiscard]] VkPipeline GetPipeline() const override;
 			[[nodiscard]] inline VkPipelineLayout GetPipelineLayout() const override { return m_pipeline_layout; }
 			[[nodiscard]] inline VkPipelineBindPoint GetPipelineBindPoint() const override { return VK_PIPELINE_BIND_POINT_GRAPHICS; }
 
 			~GraphicPipeline() = default;
 
 		private:
-			void CreateFramebuffers(const std::vector<NonOwningPtr<Texture>>& render_targets, bool clear_attachments);
+			[[nodiscard]] std::vector<VkAttachmentDescription> BuildAttachmentDescriptions(bool clear_attachments) const;
+			void CreateFramebuffers();
 			void TransitionAttachments(VkCommandBuffer cmd = VK_NULL_HANDLE);
 
 			// Private override to remove access
@@ -54,11 +58,9 @@ namespace Scop
 			std::vector<NonOwningPtr<Texture>> m_attachments;
 			std::vector<VkFramebuffer> m_framebuffers;
 			std::vector<VkClearValue> m_clears;
-			std::shared_ptr<Shader> p_vertex_shader;
-			std::shared_ptr<Shader> p_fragment_shader;
 			VkRenderPass m_renderpass = VK_NULL_HANDLE;
-			VkPipeline m_pipeline = VK_NULL_HANDLE;
 			VkPipelineLayout m_pipeline_layout = VK_NULL_HANDLE;
+			const struct GraphicPipelineVariant* p_variant = nullptr;
 			NonOwningPtr<class Renderer> p_renderer;
 			NonOwningPtr<DepthImage> p_depth;
 	};
@@ -0,0 +1,42 @@
+#ifndef __SCOP_PIPELINE_CACHE__
+#define __SCOP_PIPELINE_CACHE__
+
+#include <cstdint>
+#include <filesystem>
+
+#include <kvf.h>
+
+namespace Scop
+{
+	// Driver pipeline cache shared by every pipeline, persisted in a file per device and driver version
+	// so later runs skip most of the shader compilation.
+	class PipelineCache
+	{
+		public:
+			PipelineCache() = default;
+
+			void Init(const std::filesystem::path& directory);
+			// Writes the cache back to its file
+			void Save() noexcept;
+			void Destroy() noexcept;
+
+			inline void RecordPipelineCreation(std::uint64_t milliseconds) noexcept { m_creation_time += milliseconds; m_pipelines_created++; }
+
+			[[nodiscard]] inline VkPipelineCache Get() const noexcept { return m_cache; }
+			// Whether the cache was seeded from a previous run
+			[[nodiscard]] inline bool IsWarm() const noexcept { return m_is_warm; }
+			[[nodiscard]] inline std::uint64_t GetCreationTime() const noexcept { return m_creation_time; }
+			[[nodiscard]] inline std::uint64_t GetCreatedPipelinesCount() const noexcept { return m_pipelines_created; }
+
+			~PipelineCache() = default;
+
+		private:
+			std::filesystem::path m_path;
+			VkPipelineCache m_cache = VK_NULL_HANDLE;
+			std::uint64_t m_creation_time = 0;
+			std::uint64_t m_pipelines_created = 0;
+			bool m_is_warm = false;
+	};
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef __SCOP_PIPELINE_REGISTRY__
+#define __SCOP_PIPELINE_REGISTRY__
+
+#include <future>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+
+#include <kvf.h>
+
+#include <Renderer/Pipelines/Graphics.h>
+
+namespace Scop
+{
+	struct GraphicPipelineVariant
+	{
+		VkRenderPass renderpass = VK_NULL_HANDLE;
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+		VkPipeline pipeline = VK_NULL_HANDLE; // null while compiling in the background
+		const GraphicPipelineVariant* fallback = nullptr; // ready variant drawn with until then, sharing the shaders, attachments, blending and depth states
+
+		// Null when there is nothing to draw with yet, draws must be skipped then
+		[[nodiscard]] inline VkPipeline GetReadyPipeline() const noexcept
+		{
+			if(pipeline != VK_NULL_HANDLE || fallback == nullptr)
+				return pipeline;
+			return fallback->pipeline;
+		}
+	};
+
+	// Every graphics pipeline built so far, keyed by what makes them differ: shaders, rasterization states and attachments.
+	// Variants live until the render core goes down, so switching back to one, like toggling wireframe, costs a lookup.
+	// New variants that only differ from a ready one by their culling or polygon mode are compiled on a worker thread.
+	class PipelineRegistry
+	{
+		public:
+			PipelineRegistry();
+
+			// Builds the variant on first use, attachments are the descriptions of the render pass it draws in.
+			// The pipeline may still be compiling when a fallback is available, see GraphicPipelineVariant::GetReadyPipeline
+			[[nodiscard]] const GraphicPipelineVariant& GetGraphicPipeline(const GraphicPipelineDescriptor& descriptor, const std::vector<VkAttachmentDescription>& attachments);
+			// Picks up the pipelines compiled in the background, called once per frame
+			void Update();
+			void Destroy() noexcept;
+
+			[[nodiscard]] inline std::size_t GetGraphicPipelinesCount() const noexcept { return m_graphic_pipelines.size(); }
+
+			~PipelineRegistry() = default;
+
+		private:
+			struct GraphicPipelineKey
+			{
+				const Shader* vertex_shader;
+				const Shader* fragment_shader;
+				std::vector<VkAttachmentDescription> attachments;
+				VkCullModeFlagBits culling;
+				VkPolygonMode mode;
+				bool depth;
+				bool depth_test_equal;
+				bool depth_write;
+				bool blending;
+				bool no_vertex_inputs;
+
+				bool operator==(const GraphicPipelineKey& other) const noexcept;
+			};
+
+			struct GraphicPipelineKeyHash
+			{
+				std::size_t operator()(const GraphicPipelineKey& key) const noexcept;
+			};
+
+			struct GraphicPipelineEntry
+			{
+				GraphicPipelineVariant variant;
+				std::future<std::pair<VkPipeline, std::uint64_t>> compilation; // pipeline and compilation time in milliseconds
+				// Kept alive as the key refers to them
+				std::shared_ptr<Shader> vertex_shader;
+				std::shared_ptr<Shader> fragment_shader;
+			};
+
+		private:
+			void CreateGraphicPipeline(GraphicPipelineEntry& entry, const GraphicPipelineDescriptor& descriptor, const std::vector<VkAttachmentDescription>& attachments);
+			[[nodiscard]] const GraphicPipelineVariant* FindFallback(const GraphicPipelineKey& key) const noexcept;
+
+		private:
+			std::unordered_map<GraphicPipelineKey, GraphicPipelineEntry, GraphicPipelineKeyHash> m_graphic_pipelines;
+			bool m_compile_in_background;
+	};
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <cstdint>
+#include <string_view>
 #include <filesystem>
 
 #include <kvf.h>
@@ -12,8 +13,9 @@ namespace Scop
 	struct ShaderSetLayout
 	{
 		std::vector<std::pair<int, VkDescriptorType> > binds;
+		std::vector<std::pair<int, std::uint32_t> > arrays; // descriptor count of the bindings that are arrays, partially bound when the device allows it
 
-		ShaderSetLayout(std::vector<std::pair<int, VkDescriptorType> > b) : binds(std::move(b)) {}
+		ShaderSetLayout(std::vector<std::pair<int, VkDescriptorType> > b, std::vector<std::pair<int, std::uint32_t> > a = {}) : binds(std::move(b)), arrays(std::move(a)) {}
 	};
 
 	struct ShaderPushConstantLayout
@@ -71,6 +73,9 @@ namespace Scop
 	};
 
 	std::shared_ptr<Shader> LoadShaderFromFile(const std::filesystem::path& filepath, ShaderType type, ShaderLayout layout);
+	// Engine shaders by name, from the SPIR-V embedded at build time.
+	// Debug builds prefer the file in Assets/Shaders/Build so recompiled shaders do not need a relink
+	std::shared_ptr<Shader> LoadShader(std::string_view name, ShaderType type, ShaderLayout layout);
 }
 
 #endif
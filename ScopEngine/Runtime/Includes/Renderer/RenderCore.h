@@ -12,6 +12,10 @@
 #include <kvf.h>
 
 #include <Renderer/Memory/DeviceAllocator.h>
+#include <Renderer/UploadContext.h>
+#include <Renderer/OneShotCommandPool.h>
+#include <Renderer/DeletionQueue.h>
+#include <Renderer/Pipelines/PipelineCache.h>
 
 namespace Scop
 {
@@ -20,9 +24,19 @@ namespace Scop
 	constexpr const int DEFAULT_VERTEX_SHADER_ID = 0;
 	constexpr const int DEFAULT_FRAGMENT_SHADER_ID = 1;
 	constexpr const int BASIC_FRAGMENT_SHADER_ID = 2;
+	constexpr const int OPAQUE_FRAGMENT_SHADER_ID = 3;
+
+	constexpr const VkMemoryPropertyFlags DIRECT_WRITE_MEMORY_PROPERTIES = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 
 	std::optional<std::uint32_t> FindMemoryType(std::uint32_t type_filter, VkMemoryPropertyFlags properties, bool error = true);
 
+	class GeometryHeap;
+	class UniformRingBuffer;
+	class DescriptorAllocator;
+	class BindlessTable;
+	class FrameArena;
+	class PipelineRegistry;
+
 	#if defined(DEBUG) && defined(VK_EXT_debug_utils)
 		#define SCOP_HAS_DEBUG_UTILS_FUNCTIONS
 	#endif
@@ -37,10 +51,29 @@ namespace Scop
 			[[nodiscard]] inline VkDevice GetDevice() const noexcept { return m_device; }
 			[[nodiscard]] inline VkPhysicalDevice GetPhysicalDevice() const noexcept { return m_physical_device; }
 			[[nodiscard]] inline DeviceAllocator& GetAllocator()  noexcept { return m_allocator; }
+			[[nodiscard]] inline UploadContext& GetUploadContext() noexcept { return m_upload_context; }
+			[[nodiscard]] inline OneShotCommandPool& GetOneShotCommands() noexcept { return m_one_shot_commands; }
+			[[nodiscard]] inline DeletionQueue& GetDeletionQueue() noexcept { return m_deletion_queue; }
+			[[nodiscard]] inline PipelineCache& GetPipelineCache() noexcept { return m_pipeline_cache; }
+			[[nodiscard]] inline PipelineRegistry& GetPipelineRegistry() noexcept { return *p_pipeline_registry; }
+			[[nodiscard]] inline FrameArena& GetFrameArena() noexcept { return *p_frame_arena; }
+			[[nodiscard]] inline GeometryHeap& GetGeometryHeap() noexcept { return *p_geometry_heap; }
+			[[nodiscard]] inline UniformRingBuffer& GetUniformRing() noexcept { return *p_uniform_ring; }
+			[[nodiscard]] inline DescriptorAllocator& GetDescriptorAllocator() noexcept { return *p_descriptor_allocator; }
+			[[nodiscard]] inline BindlessTable& GetBindlessTable() noexcept { return *p_bindless_table; }
+			[[nodiscard]] inline const VkPhysicalDeviceFeatures& GetPhysicalDeviceFeatures() const noexcept { return m_features; }
+			// True on integrated GPUs, ReBAR or software devices where resources can be written by the CPU in place
+			[[nodiscard]] inline bool HasDirectWriteDeviceMemory() const noexcept { return m_has_direct_write_memory; }
+			// Partially bound and update after bind sampled image arrays
+			[[nodiscard]] inline bool HasDescriptorIndexing() const noexcept { return m_has_descriptor_indexing; }
+			// Whether a shader stage can sample the whole bindless texture array, materials own their sets otherwise
+			[[nodiscard]] inline bool HasBindlessTextures() const noexcept { return m_has_bindless_textures; }
 
 			[[nodiscard]] inline std::shared_ptr<class Shader> GetDefaultVertexShader() const { return m_internal_shaders[DEFAULT_VERTEX_SHADER_ID]; }
 			[[nodiscard]] inline std::shared_ptr<class Shader> GetBasicFragmentShader() const { return m_internal_shaders[BASIC_FRAGMENT_SHADER_ID]; }
 			[[nodiscard]] inline std::shared_ptr<class Shader> GetDefaultFragmentShader() const { return m_internal_shaders[DEFAULT_FRAGMENT_SHADER_ID]; }
+			// Default fragment shader without the colors dissolve nor the discard, for static materials
+			[[nodiscard]] inline std::shared_ptr<class Shader> GetOpaqueFragmentShader() const { return m_internal_shaders[OPAQUE_FRAGMENT_SHADER_ID]; }
 
 			inline void WaitDeviceIdle() const noexcept { vkDeviceWaitIdle(m_device); }
 
@@ -65,11 +98,25 @@ namespace Scop
 		private:
 			static RenderCore* s_instance;
 
-			std::array<std::shared_ptr<class Shader>, 3> m_internal_shaders;
+			std::array<std::shared_ptr<class Shader>, 4> m_internal_shaders;
 			DeviceAllocator m_allocator;
+			UploadContext m_upload_context;
+			OneShotCommandPool m_one_shot_commands;
+			DeletionQueue m_deletion_queue;
+			PipelineCache m_pipeline_cache;
+			std::unique_ptr<GeometryHeap> p_geometry_heap;
+			std::unique_ptr<UniformRingBuffer> p_uniform_ring;
+			std::unique_ptr<DescriptorAllocator> p_descriptor_allocator;
+			std::unique_ptr<BindlessTable> p_bindless_table;
+			std::unique_ptr<FrameArena> p_frame_arena;
+			std::unique_ptr<PipelineRegistry> p_pipeline_registry;
+			VkPhysicalDeviceFeatures m_features{};
 			VkInstance m_instance = VK_NULL_HANDLE;
 			VkDevice m_device = VK_NULL_HANDLE;
 			VkPhysicalDevice m_physical_device = VK_NULL_HANDLE;
+			bool m_has_direct_write_memory = false;
+			bool m_has_descriptor_indexing = false;
+			bool m_has_bindless_textures = false;
 	};
 }
 
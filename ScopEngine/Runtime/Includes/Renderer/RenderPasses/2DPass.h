@@ -21,7 +21,6 @@ namespace Scop
 		private:
 			GraphicPipeline m_pipeline;
 			std::shared_ptr<DescriptorSet> p_viewer_data_set;
-			std::shared_ptr<UniformBuffer> p_viewer_data_buffer;
 			std::shared_ptr<DescriptorSet> p_texture_set;
 			std::shared_ptr<Shader> p_vertex_shader;
 			std::shared_ptr<Shader> p_fragment_shader;
@@ -1,6 +1,10 @@
 #ifndef __SCOP_FORWARD_PASS__
 #define __SCOP_FORWARD_PASS__
 
+#include <cstdint>
+
+#include <Renderer/Buffer.h>
+
 namespace Scop
 {
 	class ForwardPass
@@ -8,7 +12,32 @@ namespace Scop
 		public:
 			ForwardPass() = default;
 			void Pass(class Scene& scene, class Renderer& renderer, class Texture& render_target);
+			void Destroy();
 			~ForwardPass() = default;
+
+		private:
+			// In drawing order
+			enum class DrawPipeline : std::uint8_t
+			{
+				Static,
+				Opaque,
+				Translucent
+			};
+
+			struct DrawItem
+			{
+				class Material* material;
+				VkDescriptorSet material_set; // only with sets per material
+				std::uint32_t material_index;
+				std::uint32_t page;
+				std::size_t triangle_count;
+				VkDrawIndexedIndirectCommand command;
+				DrawPipeline pipeline;
+				float distance; // squared, from the camera to the actor
+			};
+
+		private:
+			IndirectDrawBuffer m_indirect;
 	};
 }
 
@@ -0,0 +1,60 @@
+#ifndef __SCOP_TRANSFORM_BUFFER__
+#define __SCOP_TRANSFORM_BUFFER__
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include <Maths/Mat4.h>
+#include <Renderer/Buffer.h>
+#include <Renderer/RenderCore.h>
+
+namespace Scop
+{
+	constexpr std::size_t DEFAULT_TRANSFORM_BUFFER_CAPACITY = 256;
+
+	struct ModelData
+	{
+		Mat4f model_mat;
+		Mat4f normal_mat;
+	};
+
+	// Per object transforms read by the forward vertex shader with gl_InstanceIndex, object i being the i-th actor of the scene.
+	// There is one storage buffer per frame in flight and only the objects whose transform changed are rewritten.
+	class TransformBuffer
+	{
+		public:
+			TransformBuffer() = default;
+
+			void Init(std::size_t capacity = DEFAULT_TRANSFORM_BUFFER_CAPACITY);
+			// Must be called once the frame is not used by the GPU anymore,
+			// returns true if the buffer of the frame has been recreated and has to be bound again
+			bool Update(std::size_t frame_index, const std::vector<std::shared_ptr<class Actor>>& actors);
+			void Destroy() noexcept;
+
+			[[nodiscard]] inline GPUBuffer& Get(std::size_t frame_index) noexcept { return m_buffers[frame_index]; }
+
+			~TransformBuffer() = default;
+
+		private:
+			struct Slot
+			{
+				const class Actor* actor = nullptr;
+				std::uint64_t version = 0;
+
+				inline bool operator==(const Slot& other) const noexcept { return actor == other.actor && version == other.version; }
+			};
+
+		private:
+			void CreateBuffer(std::size_t frame_index, std::size_t capacity);
+
+		private:
+			std::array<GPUBuffer, MAX_FRAMES_IN_FLIGHT> m_buffers;
+			std::array<std::vector<Slot>, MAX_FRAMES_IN_FLIGHT> m_written_slots; // what each frame buffer holds
+			std::vector<ModelData> m_data;
+			std::vector<Slot> m_data_slots; // what m_data holds
+	};
+}
+
+#endif
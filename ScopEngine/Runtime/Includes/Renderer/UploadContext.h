@@ -0,0 +1,95 @@
+#ifndef __SCOP_UPLOAD_CONTEXT__
+#define __SCOP_UPLOAD_CONTEXT__
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <optional>
+
+#include <kvf.h>
+#include <Renderer/Memory/Block.h>
+
+namespace Scop
+{
+	constexpr VkDeviceSize DEFAULT_STAGING_RING_SIZE = 16ull * 1024 * 1024;
+
+	// Batches uploads to device local resources: data is copied into a persistent host visible ring
+	// and copies are recorded in a single command buffer that is submitted once per batch.
+	// When the device has a dedicated transfer queue the copies run there, and the ownership of the
+	// resources is given back to the graphics queue by a small submission that waits on the copies.
+	// Either way, any frame submitted after a batch sees the uploaded data.
+	class UploadContext
+	{
+		public:
+			UploadContext() = default;
+
+			void Init(VkDeviceSize staging_size = DEFAULT_STAGING_RING_SIZE);
+			void Destroy() noexcept;
+
+			void UploadBuffer(VkBuffer dst, VkDeviceSize dst_offset, const void* data, VkDeviceSize size);
+			// The previous content of the image is discarded, the regions offsets are relative to data
+			void UploadImage(VkImage dst, VkImageAspectFlags aspect, std::uint32_t layer_count, VkImageLayout final_layout, const void* data, VkDeviceSize size, const VkBufferImageCopy* regions, std::uint32_t regions_count, std::uint32_t texel_size);
+
+			// Submits the batch being recorded and returns its value
+			std::uint64_t Flush();
+			void Wait(std::uint64_t value);
+			void WaitIdle();
+			[[nodiscard]] bool IsComplete(std::uint64_t value);
+			// Value of the batch being recorded, or of the last submitted one
+			[[nodiscard]] inline std::uint64_t GetCurrentBatchValue() const noexcept { return m_next_value - 1; }
+			[[nodiscard]] inline bool HasPendingUploads() const noexcept { return m_recording || m_in_flight_count > 0; }
+			[[nodiscard]] inline bool UsesTransferQueue() const noexcept { return m_transfer_pool != VK_NULL_HANDLE; }
+
+			~UploadContext() = default;
+
+		private:
+			static constexpr std::size_t BATCH_COUNT = 4;
+
+			struct StagingBuffer
+			{
+				VkBuffer buffer = VK_NULL_HANDLE;
+				MemoryBlock memory;
+			};
+
+			struct Batch
+			{
+				std::vector<StagingBuffer> retained_buffers; // uploads too big for the ring
+				std::vector<VkBufferMemoryBarrier> buffer_barriers;
+				std::vector<VkImageMemoryBarrier> image_barriers;
+				VkCommandBuffer cmd = VK_NULL_HANDLE;
+				VkCommandBuffer acquire_cmd = VK_NULL_HANDLE; // only with a transfer queue
+				VkSemaphore semaphore = VK_NULL_HANDLE; // only with a transfer queue
+				VkFence fence = VK_NULL_HANDLE;
+				VkDeviceSize ring_end = 0;
+				std::uint64_t value = 0;
+			};
+
+		private:
+			VkCommandBuffer BeginBatch();
+			[[nodiscard]] StagingBuffer CreateStagingBuffer(VkDeviceSize size);
+			void DestroyStagingBuffer(StagingBuffer& buffer) noexcept;
+			[[nodiscard]] std::optional<VkDeviceSize> AllocateStaging(VkDeviceSize size, VkDeviceSize alignment) noexcept;
+			// Returns the staging buffer and the offset where the data has been written
+			std::pair<VkBuffer, VkDeviceSize> Stage(const void* data, VkDeviceSize size, VkDeviceSize alignment);
+			bool RetireOldest(bool wait) noexcept;
+
+		private:
+			std::array<Batch, BATCH_COUNT> m_batches;
+			StagingBuffer m_ring;
+			VkCommandPool m_transfer_pool = VK_NULL_HANDLE;
+			std::uint32_t m_transfer_family = VK_QUEUE_FAMILY_IGNORED;
+			std::uint32_t m_graphics_family = VK_QUEUE_FAMILY_IGNORED;
+			VkDeviceSize m_ring_size = 0;
+			VkDeviceSize m_ring_head = 0;
+			VkDeviceSize m_ring_tail = 0;
+			std::uint64_t m_next_value = 1;
+			std::uint64_t m_completed_value = 0;
+			std::size_t m_current = 0;
+			std::size_t m_oldest = 0;
+			std::size_t m_in_flight_count = 0;
+			bool m_recording = false;
+	};
+}
+
+#endif
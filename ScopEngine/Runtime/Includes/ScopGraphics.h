@@ -7,6 +7,7 @@
 #include <Graphics/Model.h>
 #include <Graphics/Scene.h>
 #include <Graphics/MeshFactory.h>
+#include <Graphics/SpriteAtlas.h>
 #include <Graphics/Cameras/Base.h>
 #include <Graphics/Cameras/FirstPerson3D.h>
 #include <Graphics/Loaders/OBJ.h>
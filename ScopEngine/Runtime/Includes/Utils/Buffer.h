@@ -3,43 +3,67 @@
 
 #include <cstdint>
 #include <cstring>
-#include <memory>
+#include <utility>
 #include <Core/Logs.h>
 
 namespace Scop
 {
+	constexpr std::size_t DEFAULT_CPU_BUFFER_ALIGNMENT = 64;
+
+	enum class CPUBufferPolicy
+	{
+		Heap,
+		Aligned, // honors the requested alignment
+		HugePages, // anonymous mapping advised for transparent huge pages, for large assets
+		View, // memory owned by someone else, see CPUBuffer::Wrap
+	};
+
+	// Move only, passing it around never copies nor refcounts the data
 	class CPUBuffer
 	{
 		public:
-			CPUBuffer() {}
-			CPUBuffer(std::size_t size) try : m_data(new std::uint8_t[size]), m_size(size)
-			{}
-			catch(...)
-			{
-				FatalError("memory allocation for a CPU buffer failed");
-			}
+			CPUBuffer() = default;
+			// The content is left uninitialized
+			CPUBuffer(std::size_t size, CPUBufferPolicy policy = CPUBufferPolicy::Heap, std::size_t alignment = DEFAULT_CPU_BUFFER_ALIGNMENT);
+			CPUBuffer(const CPUBuffer&) = delete;
+			CPUBuffer(CPUBuffer&& buffer) noexcept;
+
+			// Neither copies nor owns the memory, which must outlive the buffer
+			[[nodiscard]] static CPUBuffer Wrap(void* data, std::size_t size) noexcept;
 
+			// Views are duplicated into the heap
 			[[nodiscard]] inline CPUBuffer Duplicate() const
 			{
-				CPUBuffer buffer(m_size);
-				std::memcpy(buffer.GetData(), m_data.get(), m_size);
+				CPUBuffer buffer(m_size, (m_policy == CPUBufferPolicy::View ? CPUBufferPolicy::Heap : m_policy), m_alignment);
+				if(m_size != 0)
+					std::memcpy(buffer.GetData(), m_data, m_size);
 				return buffer;
 			}
 
 			inline bool Empty() const { return m_size == 0; }
 
 			[[nodiscard]] inline std::size_t GetSize() const noexcept { return m_size; }
+			[[nodiscard]] inline CPUBufferPolicy GetPolicy() const noexcept { return m_policy; }
 
 			template<typename T>
-			[[nodiscard]] inline T* GetDataAs() const { return reinterpret_cast<T*>(m_data.get()); }
-			[[nodiscard]] inline std::uint8_t* GetData() const { return m_data.get(); }
-			inline operator bool() const { return (bool)m_data; }
+			[[nodiscard]] inline T* GetDataAs() const { return reinterpret_cast<T*>(m_data); }
+			[[nodiscard]] inline std::uint8_t* GetData() const { return m_data; }
+			inline operator bool() const { return m_data != nullptr; }
+
+			CPUBuffer& operator=(const CPUBuffer&) = delete;
+			CPUBuffer& operator=(CPUBuffer&& buffer) noexcept;
 
-			~CPUBuffer() = default;
+			~CPUBuffer();
+
+		private:
+			void Release() noexcept;
 
 		private:
-			std::shared_ptr<std::uint8_t[]> m_data;
+			std::uint8_t* m_data = nullptr;
 			std::size_t m_size = 0;
+			std::size_t m_capacity = 0; // bytes actually reserved by the policy
+			std::size_t m_alignment = DEFAULT_CPU_BUFFER_ALIGNMENT;
+			CPUBufferPolicy m_policy = CPUBufferPolicy::Heap;
 	};
 }
 
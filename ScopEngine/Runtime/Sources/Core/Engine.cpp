@@ -38,6 +38,7 @@ namespace Scop
 			,m_imgui(&m_renderer)
 		#endif
 	{
+		m_startup_begin = SDL_GetTicks64();
 		s_instance = this;
 		std::function<void(const EventBase&)> functor = [this](const EventBase& event)
 		{
@@ -73,6 +74,7 @@ namespace Scop
 		Verify(p_current_scene, "no main scene registered");
 		float old_timestep = static_cast<float>(SDL_GetTicks64()) / 1000.0f;
 		p_current_scene->Init(&m_renderer);
+		bool first_frame = true;
 		while(m_running)
 		{
 			float current_timestep = (static_cast<float>(SDL_GetTicks64()) / 1000.0f) - old_timestep;
@@ -84,7 +86,6 @@ namespace Scop
 
 			if(m_scene_changed)
 			{
-				RenderCore::Get().WaitDeviceIdle();
 				EventBus::SendBroadcast(Internal::SceneChangedEvent{});
 				m_scene_changed = false;
 				continue;
@@ -95,10 +96,19 @@ namespace Scop
 				#ifdef DEBUG
 					m_imgui.BeginFrame();
 					m_imgui.DisplayRenderStatistics();
+					m_imgui.DisplayMemoryStatistics();
 					m_imgui.EndFrame();
 				#endif
 			m_renderer.EndFrame();
 
+			if(first_frame)
+			{
+				// Cold and warm startups are told apart to see what the pipeline cache saves
+				const PipelineCache& cache = RenderCore::Get().GetPipelineCache();
+				Message("Startup: first frame submitted after % ms (% pipeline cache, % pipelines created in % ms)", SDL_GetTicks64() - m_startup_begin, (cache.IsWarm() ? "warm" : "cold"), cache.GetCreatedPipelinesCount(), cache.GetCreationTime());
+				first_frame = false;
+			}
+
 			if(m_running)
 				m_running = !m_inputs.HasRecievedCloseEvent();
 		}
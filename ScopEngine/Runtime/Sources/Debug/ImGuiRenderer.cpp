@@ -88,6 +88,7 @@ namespace Scop
 			init_info.ImageCount = p_renderer->GetSwapchain().GetSwapchainImages().size();
 			init_info.CheckVkResultFn = [](VkResult result){ kvfCheckVk(result); };
 			init_info.RenderPass = m_renderpass;
+			init_info.PipelineCache = RenderCore::Get().GetPipelineCache().Get();
 		ImGui_ImplVulkan_Init(&init_info);
 
 		inputs.AddEventUpdateHook(ImGui_ImplSDL2_ProcessEvent);
@@ -143,6 +144,11 @@ namespace Scop
 			ImGui::Text("Drawcalls %ld", p_renderer->GetDrawCallsCounterRef());
 			ImGui::Text("Polygon drawn %ld", p_renderer->GetPolygonDrawnCounterRef());
 			ImGui::Text("Allocations count %ld", RenderCore::Get().GetAllocator().GetAllocationsCount());
+			for(std::uint32_t i = 0; i < RenderCore::Get().GetAllocator().GetHeapCount(); i++)
+			{
+				MemoryBudget budget = RenderCore::Get().GetAllocator().GetHeapBudget(i);
+				ImGui::Text("Heap %u usage %.1f / %.1f MiB", i, budget.usage / (1024.0f * 1024.0f), budget.budget / (1024.0f * 1024.0f));
+			}
 			ImGui::Text("Buffer count %ld", GPUBuffer::GetBufferCount());
 			ImGui::Text("Image count %ld", Image::GetImageCount());
 			ImGui::Text("Window dimensions: %ux%u", p_renderer->GetWindow()->GetWidth(), p_renderer->GetWindow()->GetHeight());
@@ -152,6 +158,76 @@ namespace Scop
 		frame_histogram.back() = delta;
 	}
 
+	void ImGuiRenderer::DisplayMemoryStatistics()
+	{
+		constexpr float MIB = 1024.0f * 1024.0f;
+		constexpr float CHUNK_BAR_HEIGHT = 12.0f;
+
+		auto display_stats = [MIB](const MemoryStatistics& stats)
+		{
+			ImGui::Text("Used %.2f / %.2f MiB in %ld chunks", stats.used_bytes / MIB, stats.allocated_bytes / MIB, stats.chunk_count);
+			ImGui::Text("Blocks %ld, free blocks %ld, largest free %.2f MiB", stats.block_count, stats.free_block_count, stats.largest_free_block / MIB);
+			ImGui::Text("Fragmentation %.1f%%", stats.GetFragmentation() * 100.0f);
+			ImGui::Text("Allocations %ld / frame, frees %ld / frame", stats.allocations_per_frame, stats.deallocations_per_frame);
+		};
+
+		DeviceAllocator& allocator = RenderCore::Get().GetAllocator();
+		ImGui::SetNextWindowPos(ImVec2{ 20.0f, 400.0f }, ImGuiCond_FirstUseEver);
+		if(ImGui::Begin("Device Memory"))
+		{
+			display_stats(allocator.GetTotalStatistics());
+			if(ImGui::Button("Dump block map to JSON") && allocator.DumpJsonReport("scop_memory_dump.json"))
+				Message("Device Allocator: block map written to scop_memory_dump.json");
+			ImGui::Separator();
+			if(ImGui::CollapsingHeader("Heaps"))
+			{
+				for(std::uint32_t i = 0; i < allocator.GetHeapCount(); i++)
+				{
+					MemoryBudget budget = allocator.GetHeapBudget(i);
+					ImGui::Text("Heap %u (budget %.1f / %.1f MiB)", i, budget.usage / MIB, budget.budget / MIB);
+					ImGui::Indent();
+					display_stats(allocator.GetHeapStatistics(i));
+					ImGui::Unindent();
+				}
+			}
+			if(ImGui::CollapsingHeader("Memory types"))
+			{
+				for(std::uint32_t i = 0; i < allocator.GetMemoryTypeCount(); i++)
+				{
+					MemoryStatistics stats = allocator.GetMemoryTypeStatistics(i);
+					if(stats.chunk_count == 0)
+						continue;
+					ImGui::Text("Memory type %u (heap %u)", i, allocator.GetMemoryTypeHeapIndex(i));
+					ImGui::Indent();
+					display_stats(stats);
+					ImGui::Unindent();
+				}
+			}
+			if(ImGui::CollapsingHeader("Chunks"))
+			{
+				ImDrawList* draw_list = ImGui::GetWindowDrawList();
+				for(const auto& chunk : allocator.GetChunks())
+				{
+					ImGui::Text("Type %d %s%s, %.2f / %.2f MiB", chunk->GetMemoryTypeIndex(), (chunk->GetPool() == MemoryPool::Linear ? "linear" : "optimal"), (chunk->IsDedicated() ? " dedicated" : ""), chunk->GetUsedSize() / MIB, chunk->GetSize() / MIB);
+					ImVec2 pos = ImGui::GetCursorScreenPos();
+					float width = ImGui::GetContentRegionAvail().x;
+					float scale = width / static_cast<float>(chunk->GetSize());
+					draw_list->AddRectFilled(pos, ImVec2{ pos.x + width, pos.y + CHUNK_BAR_HEIGHT }, IM_COL32(40, 40, 40, 255));
+					chunk->ForEachBlockRange([&](VkDeviceSize offset, VkDeviceSize size, bool free)
+					{
+						if(free)
+							return;
+						float start = pos.x + offset * scale;
+						float end = std::max(start + 1.0f, start + size * scale); // keeps tiny blocks visible
+						draw_list->AddRectFilled(ImVec2{ start, pos.y }, ImVec2{ end, pos.y + CHUNK_BAR_HEIGHT }, IM_COL32(80, 160, 220, 255));
+					});
+					ImGui::Dummy(ImVec2{ width, CHUNK_BAR_HEIGHT });
+				}
+			}
+		}
+		ImGui::End();
+	}
+
 	void ImGuiRenderer::EndFrame()
 	{
 		VkFramebuffer fb = m_framebuffers[p_renderer->GetSwapchain().GetImageIndex()];
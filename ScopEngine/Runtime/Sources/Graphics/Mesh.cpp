@@ -13,19 +13,18 @@ namespace Scop
 	void Mesh::Draw(VkCommandBuffer cmd, std::size_t& drawcalls, std::size_t& polygondrawn, std::size_t submesh_index) const noexcept
 	{
 		Verify(submesh_index < m_sub_meshes.size(), "invalid submesh index");
-		m_sub_meshes[submesh_index].vbo.Bind(cmd);
-		m_sub_meshes[submesh_index].ibo.Bind(cmd);
-		RenderCore::Get().vkCmdDrawIndexed(cmd, static_cast<std::uint32_t>(m_sub_meshes[submesh_index].ibo.GetSize() / sizeof(std::uint32_t)), 1, 0, 0, 0);
-		polygondrawn += m_sub_meshes[submesh_index].triangle_count;
+		const SubMesh& mesh = m_sub_meshes[submesh_index];
+		if(!mesh.geometry.IsValid())
+			return;
+		RenderCore::Get().GetGeometryHeap().Bind(cmd, mesh.geometry.page);
+		RenderCore::Get().vkCmdDrawIndexed(cmd, mesh.geometry.index_count, 1, mesh.geometry.first_index, static_cast<std::int32_t>(mesh.geometry.vertex_offset), 0);
+		polygondrawn += mesh.triangle_count;
 		drawcalls++;
 	}
 
 	Mesh::~Mesh()
 	{
 		for(auto& mesh : m_sub_meshes)
-		{
-			mesh.vbo.Destroy();
-			mesh.ibo.Destroy();
-		}
+			RenderCore::Get().GetGeometryHeap().Free(mesh.geometry);
 	}
 }
@@ -19,26 +19,6 @@ namespace Scop
 		m_materials.back() = std::make_shared<Material>(textures);
 	}
 
-	void Model::Draw(VkCommandBuffer cmd, const DescriptorSet& matrices_set, const GraphicPipeline& pipeline, DescriptorSet& set, std::size_t& drawcalls, std::size_t& polygondrawn, std::size_t frame_index) const
-	{
-		if(!p_mesh)
-			return;
-		for(std::size_t i = 0; i < GetSubMeshCount(); i++)
-		{
-			std::shared_ptr<Material> material;
-			if(!m_materials[i])
-				material = m_materials.back();
-			else
-				material = m_materials[i];
-			if(!material->IsSetInit())
-				material->UpdateDescriptorSet(set);
-			material->Bind(frame_index, cmd);
-			std::array<VkDescriptorSet, 2> sets = { matrices_set.GetSet(frame_index), material->GetSet(frame_index) };
-			RenderCore::Get().vkCmdBindDescriptorSets(cmd, pipeline.GetPipelineBindPoint(), pipeline.GetPipelineLayout(), 0, sets.size(), sets.data(), 0, nullptr);
-			p_mesh->Draw(cmd, drawcalls, polygondrawn, i);
-		}
-	}
-
 	RadianAnglef GetAngleBetweenVectors(const Vec3f& a, const Vec3f& b) noexcept
 	{
 		float cosine_theta = (a.DotProduct(b)) / (a.GetLength() * b.GetLength());
@@ -49,6 +49,13 @@ namespace Scop
 		return *sprite;
 	}
 
+	Sprite& Scene::CreateSprite(const SpriteAtlasRegion& region) noexcept
+	{
+		std::shared_ptr<Sprite> sprite = std::make_shared<Sprite>(region);
+		m_sprites.push_back(sprite);
+		return *sprite;
+	}
+
 	void Scene::SwitchToChild(std::string_view name) const noexcept
 	{
 		auto it = std::find_if(m_scene_children.begin(), m_scene_children.end(), [name](const Scene& scene){ return name == scene.GetName(); });
@@ -76,31 +83,35 @@ namespace Scop
 			}
 
 			if(event.What() == Event::ResizeEventCode || event.What() == Event::SceneHasChangedEventCode)
+			{
 				m_pipeline.Destroy(); // Ugly but f*ck off
+				m_opaque_pipeline.Destroy();
+				m_translucent_pipeline.Destroy();
+			}
 		};
 		EventBus::RegisterListener({ functor, m_name + std::to_string(reinterpret_cast<std::uintptr_t>(this)) });
 
 		auto vertex_shader = RenderCore::Get().GetDefaultVertexShader();
 		m_depth.Init(renderer->GetSwapchain().GetSwapchainImages().back().GetWidth(), renderer->GetSwapchain().GetSwapchainImages().back().GetHeight());
-		m_forward.matrices_buffer = std::make_shared<UniformBuffer>();
-		m_forward.matrices_buffer->Init(sizeof(ViewerData));
+		m_forward.transforms = std::make_shared<TransformBuffer>();
+		m_forward.transforms->Init();
 
 		m_forward.matrices_set = std::make_shared<DescriptorSet>(vertex_shader->GetShaderLayout().set_layouts[0].second, vertex_shader->GetPipelineLayout().set_layouts[0], ShaderType::Vertex);
 		for(std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 		{
-			m_forward.matrices_set->SetUniformBuffer(i, 0, m_forward.matrices_buffer->Get(i));
+			m_forward.matrices_set->SetUniformBuffer(i, 0, RenderCore::Get().GetUniformRing().GetBuffer(), sizeof(ViewerData));
+			m_forward.matrices_set->SetStorageBuffer(i, 1, m_forward.transforms->Get(i));
 			m_forward.matrices_set->Update(i);
 		}
-		m_forward.albedo_set = std::make_shared<DescriptorSet>(m_descriptor.fragment_shader->GetShaderLayout().set_layouts[0].second, m_descriptor.fragment_shader->GetPipelineLayout().set_layouts[0], ShaderType::Fragment);
 		for(auto& child : m_scene_children)
 			child.Init(renderer);
 	}
 
 	void Scene::Update(Inputs& input, float timestep, float aspect)
 	{
-		for(auto actor : m_actors)
+		for(const auto& actor : m_actors)
 			actor->Update(this, input, timestep);
-		for(auto sprite : m_sprites)
+		for(const auto& sprite : m_sprites)
 			sprite->Update(this, input, timestep);
 		if(m_descriptor.camera)
 			m_descriptor.camera->Update(input, aspect, timestep);
@@ -113,8 +124,11 @@ namespace Scop
 		m_actors.clear();
 		m_sprites.clear();
 		m_pipeline.Destroy();
+		m_opaque_pipeline.Destroy();
+		m_translucent_pipeline.Destroy();
 		m_descriptor.fragment_shader.reset();
-		m_forward.matrices_buffer->Destroy();
+		m_descriptor.opaque_fragment_shader.reset();
+		m_forward.transforms->Destroy();
 		for(auto& child : m_scene_children)
 			child.Destroy();
 	}
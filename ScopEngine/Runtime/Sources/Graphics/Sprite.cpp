@@ -15,6 +15,16 @@ namespace Scop
 			p_script->OnInit(this);
 	}
 
+	Sprite::Sprite(const SpriteAtlasRegion& region)
+	{
+		Verify((bool)region.page, "Sprite: invalid atlas region");
+		p_mesh = CreateQuad(0, 0, region.size.x, region.size.y);
+		p_texture = region.page;
+		m_uv_rect = region.uv_rect;
+		if(p_script)
+			p_script->OnInit(this);
+	}
+
 	void Sprite::Update(NonOwningPtr<Scene> scene, Inputs& input, float delta)
 	{
 		if(p_script)
@@ -0,0 +1,128 @@
+#include <Graphics/SpriteAtlas.h>
+#include <Core/Logs.h>
+
+#include <algorithm>
+#include <cstring>
+
+#define STB_RECT_PACK_IMPLEMENTATION
+#define STBRP_STATIC
+
+#if defined(__GNUC__)
+	#pragma GCC diagnostic push
+	#pragma GCC diagnostic ignored "-Wunused-function"
+		#include <imstb_rectpack.h>
+	#pragma GCC diagnostic pop
+#elif defined(__clang__)
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wunused-function"
+		#include <imstb_rectpack.h>
+	#pragma clang diagnostic pop
+#else
+	#include <imstb_rectpack.h>
+#endif
+
+namespace Scop
+{
+	constexpr std::uint32_t ATLAS_PIXEL_SIZE = 4; // RGBA8
+
+	SpriteAtlas::SpriteAtlas(std::uint32_t page_size, std::uint32_t padding) : m_page_size(page_size), m_padding(padding)
+	{
+		Verify(page_size > 0, "Sprite atlas : invalid page size");
+	}
+
+	std::size_t SpriteAtlas::AddImage(CPUBuffer pixels, std::uint32_t width, std::uint32_t height)
+	{
+		Verify(!m_is_built, "Sprite atlas : cannot add images to an already built atlas");
+		Verify(pixels && pixels.GetSize() >= static_cast<std::size_t>(width) * height * ATLAS_PIXEL_SIZE, "Sprite atlas : invalid image data");
+		m_images.push_back({ std::move(pixels), width, height });
+		m_regions.emplace_back();
+		return m_regions.size() - 1;
+	}
+
+	void SpriteAtlas::Build()
+	{
+		if(m_is_built)
+			return;
+
+		std::vector<std::size_t> pending(m_images.size());
+		for(std::size_t i = 0; i < pending.size(); i++)
+			pending[i] = i;
+
+		while(!pending.empty())
+		{
+			// Images that do not fit in a standard page get a page of their own
+			std::uint32_t page_width = m_page_size;
+			std::uint32_t page_height = m_page_size;
+			for(std::size_t id : pending)
+			{
+				page_width = std::max(page_width, m_images[id].width + m_padding);
+				page_height = std::max(page_height, m_images[id].height + m_padding);
+			}
+
+			std::vector<stbrp_node> nodes(page_width);
+			stbrp_context context;
+			stbrp_init_target(&context, page_width, page_height, nodes.data(), nodes.size());
+
+			std::vector<stbrp_rect> rects(pending.size());
+			for(std::size_t i = 0; i < pending.size(); i++)
+			{
+				rects[i].id = static_cast<int>(pending[i]);
+				rects[i].w = m_images[pending[i]].width + m_padding;
+				rects[i].h = m_images[pending[i]].height + m_padding;
+			}
+			stbrp_pack_rects(&context, rects.data(), rects.size());
+
+			std::uint32_t used_height = 0;
+			for(const stbrp_rect& rect : rects)
+			{
+				if(rect.was_packed)
+					used_height = std::max(used_height, static_cast<std::uint32_t>(rect.y + rect.h));
+			}
+
+			CPUBuffer page_pixels(static_cast<std::size_t>(page_width) * used_height * ATLAS_PIXEL_SIZE, CPUBufferPolicy::HugePages);
+			std::memset(page_pixels.GetData(), 0, page_pixels.GetSize());
+			std::shared_ptr<Texture> page = std::make_shared<Texture>();
+
+			pending.clear();
+			for(const stbrp_rect& rect : rects)
+			{
+				if(!rect.was_packed)
+				{
+					pending.push_back(rect.id);
+					continue;
+				}
+				const PendingImage& image = m_images[rect.id];
+				for(std::uint32_t row = 0; row < image.height; row++)
+				{
+					std::uint8_t* dst = page_pixels.GetData() + ((rect.y + row) * page_width + rect.x) * ATLAS_PIXEL_SIZE;
+					const std::uint8_t* src = image.pixels.GetData() + row * image.width * ATLAS_PIXEL_SIZE;
+					std::memcpy(dst, src, image.width * ATLAS_PIXEL_SIZE);
+				}
+				SpriteAtlasRegion& region = m_regions[rect.id];
+				region.page = page;
+				region.size = Vec2ui{ image.width, image.height };
+				region.uv_rect = Vec4f{
+					static_cast<float>(rect.x) / page_width,
+					static_cast<float>(rect.y) / used_height,
+					static_cast<float>(image.width) / page_width,
+					static_cast<float>(image.height) / used_height
+				};
+			}
+
+			page->Init(std::move(page_pixels), page_width, used_height);
+			m_pages.push_back(page);
+		}
+
+		Message("Sprite atlas : packed % images into % pages", m_regions.size(), m_pages.size());
+		m_images.clear();
+		m_images.shrink_to_fit();
+		m_is_built = true;
+	}
+
+	const SpriteAtlasRegion& SpriteAtlas::GetRegion(std::size_t id) const
+	{
+		Verify(m_is_built, "Sprite atlas : atlas has not been built");
+		Verify(id < m_regions.size(), "Sprite atlas : invalid image id %", id);
+		return m_regions[id];
+	}
+}
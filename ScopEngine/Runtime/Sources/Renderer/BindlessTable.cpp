@@ -0,0 +1,184 @@
+#include <Renderer/BindlessTable.h>
+#include <Core/Logs.h>
+
+#include <cstring>
+#include <algorithm>
+
+namespace Scop
+{
+	void BindlessTable::Init(const Shader& shader)
+	{
+		VkDescriptorSetLayout layout = shader.GetPipelineLayout().set_layouts[0];
+		m_partially_bound = RenderCore::Get().HasDescriptorIndexing();
+		m_per_material = !RenderCore::Get().HasBindlessTextures();
+		for(std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+			m_material_buffers[i].Init(BufferType::HighDynamic, DEFAULT_BINDLESS_MATERIAL_CAPACITY * sizeof(BindlessMaterialData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, {});
+		if(m_per_material)
+		{
+			m_material_set = DescriptorSet{ shader.GetShaderLayout().set_layouts[0].second, layout, ShaderType::Fragment };
+			Message("Vulkan: bindless table created (sets per material)");
+			return;
+		}
+
+		CPUBuffer default_pixels{ kvfFormatSize(VK_FORMAT_R8G8B8A8_SRGB) };
+		default_pixels.GetDataAs<std::uint32_t>()[0] = 0xFFFFFFFF;
+		m_default_texture.Init(std::move(default_pixels), 1, 1, VK_FORMAT_R8G8B8A8_SRGB);
+
+		// Without partial binding every slot must hold a valid descriptor
+		m_textures.assign(MAX_BINDLESS_TEXTURES, m_partially_bound ? nullptr : &m_default_texture);
+		m_free_slots.resize(MAX_BINDLESS_TEXTURES);
+		for(std::uint32_t i = 0; i < MAX_BINDLESS_TEXTURES; i++)
+			m_free_slots[i] = MAX_BINDLESS_TEXTURES - i - 1;
+
+		std::array<VkDescriptorPoolSize, 2> pool_sizes{};
+		pool_sizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		pool_sizes[0].descriptorCount = MAX_BINDLESS_TEXTURES * MAX_FRAMES_IN_FLIGHT;
+		pool_sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		pool_sizes[1].descriptorCount = MAX_FRAMES_IN_FLIGHT;
+
+		VkDescriptorPoolCreateInfo pool_info{};
+		pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		pool_info.flags = (m_partially_bound ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT : 0);
+		pool_info.poolSizeCount = pool_sizes.size();
+		pool_info.pPoolSizes = pool_sizes.data();
+		pool_info.maxSets = MAX_FRAMES_IN_FLIGHT;
+		if(RenderCore::Get().vkCreateDescriptorPool(RenderCore::Get().GetDevice(), &pool_info, nullptr, &m_pool) != VK_SUCCESS)
+			FatalError("Vulkan: failed to create the bindless descriptor pool");
+
+		std::array<VkDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> layouts;
+		layouts.fill(layout);
+		VkDescriptorSetAllocateInfo alloc_info{};
+		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		alloc_info.descriptorPool = m_pool;
+		alloc_info.descriptorSetCount = layouts.size();
+		alloc_info.pSetLayouts = layouts.data();
+		if(RenderCore::Get().vkAllocateDescriptorSets(RenderCore::Get().GetDevice(), &alloc_info, m_sets.data()) != VK_SUCCESS)
+			FatalError("Vulkan: failed to allocate the bindless descriptor sets");
+
+		for(std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+			m_written_textures[i].assign(MAX_BINDLESS_TEXTURES, TextureState{});
+		Message("Vulkan: bindless table created (% textures, %)", MAX_BINDLESS_TEXTURES, m_partially_bound ? "partially bound" : "fully bound");
+	}
+
+	void BindlessTable::BeginFrame(std::size_t frame_index) noexcept
+	{
+		m_materials[frame_index].clear();
+	}
+
+	std::uint32_t BindlessTable::RegisterTexture(Image& image)
+	{
+		// The texture is the only one of the set of its material
+		if(m_per_material)
+			return 0;
+		auto it = m_texture_slots.find(&image);
+		if(it != m_texture_slots.end())
+			return it->second;
+		if(m_free_slots.empty())
+			FatalError("Renderer: bindless table is full, % textures are already registered", MAX_BINDLESS_TEXTURES);
+		std::uint32_t slot = m_free_slots.back();
+		m_free_slots.pop_back();
+		m_textures[slot] = &image;
+		m_texture_slots.emplace(&image, slot);
+		return slot;
+	}
+
+	void BindlessTable::ReleaseTexture(const Image& image) noexcept
+	{
+		auto it = m_texture_slots.find(&image);
+		if(it == m_texture_slots.end())
+			return;
+		// Each set is only written once its frame is done, the slot can be reused right away.
+		// The handles of the next image of the slot may be the ones of this destroyed image, it must be rewritten
+		m_textures[it->second] = (m_partially_bound ? nullptr : &m_default_texture);
+		for(std::vector<TextureState>& written : m_written_textures)
+			written[it->second] = TextureState{};
+		m_free_slots.push_back(it->second);
+		m_texture_slots.erase(it);
+	}
+
+	std::uint32_t BindlessTable::PushMaterial(std::size_t frame_index, const BindlessMaterialData& data)
+	{
+		m_materials[frame_index].push_back(data);
+		return m_materials[frame_index].size() - 1;
+	}
+
+	VkDescriptorSet BindlessTable::Update(std::size_t frame_index, VkCommandBuffer cmd)
+	{
+		const std::vector<BindlessMaterialData>& materials = m_materials[frame_index];
+		GPUBuffer& buffer = m_material_buffers[frame_index];
+		if(buffer.GetSize() < materials.size() * sizeof(BindlessMaterialData))
+		{
+			std::size_t capacity = std::max(materials.size(), buffer.GetSize() / sizeof(BindlessMaterialData) * 2);
+			buffer.Destroy();
+			buffer.Init(BufferType::HighDynamic, capacity * sizeof(BindlessMaterialData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, {});
+		}
+		if(!materials.empty())
+			std::memcpy(buffer.GetMap(), materials.data(), materials.size() * sizeof(BindlessMaterialData));
+		if(m_per_material)
+			return VK_NULL_HANDLE;
+
+		// The infos are written in place, they must not move
+		m_writes.clear();
+		m_image_infos.resize(MAX_BINDLESS_TEXTURES);
+		std::vector<TextureState>& written = m_written_textures[frame_index];
+		for(std::uint32_t slot = 0; slot < MAX_BINDLESS_TEXTURES; slot++)
+		{
+			Image* image = m_textures[slot];
+			if(image == nullptr || !image->IsInit())
+				continue;
+			if(image->GetLayout() != VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+				image->TransitionLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, cmd);
+			TextureState state{ image->GetImageView(), image->GetSampler() };
+			if(written[slot] == state)
+				continue;
+			written[slot] = state;
+			m_image_infos[slot].sampler = state.sampler;
+			m_image_infos[slot].imageView = state.image_view;
+			m_image_infos[slot].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			m_writes.push_back(kvfWriteImageToDescriptorSet(RenderCore::Get().GetDevice(), m_sets[frame_index], &m_image_infos[slot], 0));
+			m_writes.back().dstArrayElement = slot;
+		}
+
+		VkDescriptorBufferInfo buffer_info{};
+		if(m_written_material_buffers[frame_index] != buffer.Get())
+		{
+			m_written_material_buffers[frame_index] = buffer.Get();
+			buffer_info.buffer = buffer.Get();
+			buffer_info.offset = buffer.GetOffset();
+			buffer_info.range = VK_WHOLE_SIZE;
+			m_writes.push_back(kvfWriteStorageBufferToDescriptorSet(RenderCore::Get().GetDevice(), m_sets[frame_index], &buffer_info, BINDLESS_MATERIALS_BINDING));
+		}
+
+		if(!m_writes.empty())
+			RenderCore::Get().vkUpdateDescriptorSets(RenderCore::Get().GetDevice(), m_writes.size(), m_writes.data(), 0, nullptr);
+		return m_sets[frame_index];
+	}
+
+	void BindlessTable::UpdateMaterialSet(DescriptorSet& set, std::size_t frame_index, Image& albedo, VkCommandBuffer cmd)
+	{
+		set.SetImage(frame_index, 0, albedo);
+		set.SetStorageBuffer(frame_index, BINDLESS_MATERIALS_BINDING, m_material_buffers[frame_index]);
+		set.Update(frame_index, cmd);
+	}
+
+	void BindlessTable::Destroy() noexcept
+	{
+		if(m_pool != VK_NULL_HANDLE)
+			RenderCore::Get().vkDestroyDescriptorPool(RenderCore::Get().GetDevice(), m_pool, nullptr);
+		m_pool = VK_NULL_HANDLE;
+		m_sets.fill(VK_NULL_HANDLE);
+		for(std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			m_material_buffers[i].Destroy();
+			m_materials[i].clear();
+			m_written_textures[i].clear();
+			m_written_material_buffers[i] = VK_NULL_HANDLE;
+		}
+		m_textures.clear();
+		m_free_slots.clear();
+		m_texture_slots.clear();
+		m_default_texture.Destroy();
+		m_material_set = DescriptorSet{};
+		Message("Vulkan: bindless table destroyed");
+	}
+}
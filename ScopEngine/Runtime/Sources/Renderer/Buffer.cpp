@@ -2,26 +2,29 @@
 #include <Core/Logs.h>
 #include <Renderer/Buffer.h>
 
+#include <algorithm>
+
 namespace Scop
 {
 	void GPUBuffer::Init(BufferType type, VkDeviceSize size, VkBufferUsageFlags usage, CPUBuffer data)
 	{
-		if(type == BufferType::Constant)
+		if(type == BufferType::Constant && data.Empty())
 		{
-			if(data.Empty())
-			{
-				Warning("Vulkan: trying to create constant buffer without data (constant buffers cannot be modified after creation)");
-				return;
-			}
-			m_usage = usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-			m_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			Warning("Vulkan: trying to create constant buffer without data (constant buffers cannot be modified after creation)");
+			return;
+		}
+		if(type == BufferType::Constant || type == BufferType::LowDynamic)
+		{
+			// Device local buffers are created directly, written in place when the CPU can see them and uploaded otherwise
+			m_usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+			m_flags = (RenderCore::Get().HasDirectWriteDeviceMemory() ? DIRECT_WRITE_MEMORY_PROPERTIES : static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
 		}
 		else if(type == BufferType::HighDynamic)
 		{
 			m_usage = usage;
 			m_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 		}
-		else // LowDynamic or Staging
+		else // Staging
 		{
 			m_usage = usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
 			m_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
@@ -33,12 +36,7 @@ namespace Scop
 		CreateBuffer(size, m_usage, m_flags);
 
 		if(!data.Empty())
-		{
-			if(m_memory.map != nullptr)
-				std::memcpy(m_memory.map, data.GetData(), data.GetSize());
-		}
-		if(type == BufferType::Constant || type == BufferType::LowDynamic)
-			PushToGPU();
+			Write(data.GetData(), data.GetSize());
 	}
 
 	void GPUBuffer::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
@@ -49,10 +47,18 @@ namespace Scop
 		VkMemoryRequirements mem_requirements;
 		RenderCore::Get().vkGetBufferMemoryRequirements(device, m_buffer, &mem_requirements);
 
+		std::optional<std::uint32_t> memory_type = FindMemoryType(mem_requirements.memoryTypeBits, properties, properties != DIRECT_WRITE_MEMORY_PROPERTIES);
+		if(!memory_type.has_value()) // The buffer cannot live in the host visible device local memory types
+		{
+			properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+			memory_type = FindMemoryType(mem_requirements.memoryTypeBits, properties);
+		}
+		m_flags = properties;
+
 		if(usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT)
-			m_memory = RenderCore::Get().GetAllocator().Allocate(size, mem_requirements.alignment, *FindMemoryType(mem_requirements.memoryTypeBits, properties));
+			m_memory = RenderCore::Get().GetAllocator().Allocate(size, mem_requirements.alignment, *memory_type);
 		else
-			m_memory = RenderCore::Get().GetAllocator().Allocate(mem_requirements.size, mem_requirements.alignment, *FindMemoryType(mem_requirements.memoryTypeBits, properties));
+			m_memory = RenderCore::Get().GetAllocator().Allocate(mem_requirements.size, mem_requirements.alignment, *memory_type);
 		RenderCore::Get().vkBindBufferMemory(device, m_buffer, m_memory.memory, m_memory.offset);
 		Message("Vulkan: created buffer");
 		s_buffer_count++;
@@ -71,39 +77,48 @@ namespace Scop
 			return false;
 		}
 
-		VkCommandBuffer cmd = kvfCreateCommandBuffer(RenderCore::Get().GetDevice());
-		kvfBeginCommandBuffer(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-		kvfCopyBufferToBuffer(cmd, m_buffer, buffer.Get(), m_memory.size);
-		kvfEndCommandBuffer(cmd);
-		VkFence fence = kvfCreateFence(RenderCore::Get().GetDevice());
-		kvfSubmitSingleTimeCommandBuffer(RenderCore::Get().GetDevice(), cmd, KVF_GRAPHICS_QUEUE, fence);
-		kvfWaitForFence(RenderCore::Get().GetDevice(), fence);	
-		kvfDestroyFence(RenderCore::Get().GetDevice(), fence);
+		// Pending uploads to the source are acquired by the graphics queue before this copy, as the one shot pool flushes them first
+		OneShotCommandPool& commands = RenderCore::Get().GetOneShotCommands();
+		kvfCopyBufferToBuffer(commands.Get(), m_buffer, buffer.Get(), m_memory.size);
+		commands.WaitIdle();
 		return true;
 	}
 
-	void GPUBuffer::PushToGPU() noexcept
+	void GPUBuffer::Write(const void* data, VkDeviceSize size, VkDeviceSize offset)
 	{
-		GPUBuffer new_buffer;
-		new_buffer.m_usage = (this->m_usage & 0xFFFFFFFC) | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-		new_buffer.m_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-		new_buffer.CreateBuffer(m_memory.size, new_buffer.m_usage, new_buffer.m_flags);
-
-		if(new_buffer.CopyFrom(*this))
-			Swap(new_buffer);
-		new_buffer.Destroy();
-		Message("Vulkan: pushed buffer to GPU memory");
+		// A pending relocation copy would overwrite the new memory, the upload is ordered after it
+		if(m_memory.map != nullptr && m_relocated_buffer == VK_NULL_HANDLE)
+			std::memcpy(static_cast<std::uint8_t*>(m_memory.map) + offset, data, size);
+		else if(m_usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT)
+		{
+			RenderCore::Get().GetUploadContext().UploadBuffer(m_buffer, offset, data, size);
+			m_upload_value = RenderCore::Get().GetUploadContext().GetCurrentBatchValue();
+		}
+		else
+			Error("Vulkan: buffer cannot be written because it is neither host visible nor a transfer destination");
 	}
 
 	void GPUBuffer::Destroy() noexcept
 	{
 		if(m_buffer == VK_NULL_HANDLE)
 			return;
-		RenderCore::Get().vkDestroyBuffer(RenderCore::Get().GetDevice(), m_buffer, nullptr);
-		RenderCore::Get().GetAllocator().Deallocate(m_memory);
+		if(m_is_relocatable)
+		{
+			RenderCore::Get().GetAllocator().GetDefragmenter().CancelRelocation(this);
+			RenderCore::Get().GetAllocator().SetRelocatable(m_memory, nullptr);
+		}
+		m_is_relocatable = false;
+		// Frames in flight may still read the buffer, and its last upload may be pending. Copies from
+		// the one shot commands are waited for by CopyFrom, no one shot batch can target it anymore
+		RenderCore::Get().GetDeletionQueue().Push([buffer = m_buffer, memory = m_memory]()
+		{
+			RenderCore::Get().vkDestroyBuffer(RenderCore::Get().GetDevice(), buffer, nullptr);
+			RenderCore::Get().GetAllocator().Deallocate(memory);
+			Message("Vulkan: destroyed buffer");
+		}, m_upload_value, 0);
 		m_buffer = VK_NULL_HANDLE;
+		m_upload_value = 0;
 		m_memory = NULL_MEMORY_BLOCK;
-		Message("Vulkan: destroyed buffer");
 		s_buffer_count--;
 	}
 
@@ -113,13 +128,80 @@ namespace Scop
 		m_memory.Swap(buffer.m_memory);
 		std::swap(m_usage, buffer.m_usage);
 		std::swap(m_flags, buffer.m_flags);
+		std::swap(m_upload_value, buffer.m_upload_value);
 	}
 
-	void VertexBuffer::SetData(CPUBuffer data)
+	void GPUBuffer::MakeRelocatable() noexcept
 	{
-		if(data.GetSize() > m_memory.size)
+		if(m_buffer == VK_NULL_HANDLE || !(m_usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) || !(m_usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT))
+			return;
+		m_is_relocatable = true;
+		RenderCore::Get().GetAllocator().SetRelocatable(m_memory, this);
+	}
+
+	bool GPUBuffer::Relocate(VkCommandBuffer cmd, const MemoryBlock& new_block)
+	{
+		VkDevice device = RenderCore::Get().GetDevice();
+		VkBuffer new_buffer = kvfCreateBuffer(device, m_usage, m_memory.size);
+		VkMemoryRequirements mem_requirements;
+		RenderCore::Get().vkGetBufferMemoryRequirements(device, new_buffer, &mem_requirements);
+		if(mem_requirements.size > new_block.size || new_block.offset % mem_requirements.alignment != 0)
 		{
-			Error("Vulkan: trying to store to much data in a vertex buffer (% bytes in % bytes)", data.GetSize(), m_memory.size);
+			RenderCore::Get().vkDestroyBuffer(device, new_buffer, nullptr);
+			return false;
+		}
+		RenderCore::Get().vkBindBufferMemory(device, new_buffer, new_block.memory, new_block.offset);
+		kvfCopyBufferToBuffer(cmd, new_buffer, m_buffer, m_memory.size);
+		m_relocated_buffer = m_buffer;
+		m_buffer = new_buffer;
+		m_memory = new_block;
+		return true;
+	}
+
+	void GPUBuffer::ReleaseRelocatedResources() noexcept
+	{
+		if(m_relocated_buffer != VK_NULL_HANDLE)
+			RenderCore::Get().vkDestroyBuffer(RenderCore::Get().GetDevice(), m_relocated_buffer, nullptr);
+		m_relocated_buffer = VK_NULL_HANDLE;
+	}
+
+	void GPUBuffer::RetireRelocatedResources() noexcept
+	{
+		if(m_relocated_buffer != VK_NULL_HANDLE)
+			RenderCore::Get().GetDeletionQueue().Push([buffer = m_relocated_buffer]() { RenderCore::Get().vkDestroyBuffer(RenderCore::Get().GetDevice(), buffer, nullptr); });
+		m_relocated_buffer = VK_NULL_HANDLE;
+	}
+
+	GPUBuffer::GPUBuffer(GPUBuffer&& buffer) noexcept
+	{
+		*this = std::move(buffer);
+	}
+
+	GPUBuffer& GPUBuffer::operator=(GPUBuffer&& buffer) noexcept
+	{
+		if(this == &buffer)
+			return *this;
+		std::swap(m_buffer, buffer.m_buffer);
+		std::swap(m_relocated_buffer, buffer.m_relocated_buffer);
+		m_memory.Swap(buffer.m_memory);
+		std::swap(m_usage, buffer.m_usage);
+		std::swap(m_flags, buffer.m_flags);
+		std::swap(m_is_relocatable, buffer.m_is_relocatable);
+		// The allocator and defragmenter know relocatable buffers by address
+		if(m_is_relocatable)
+			RenderCore::Get().GetAllocator().SetRelocatable(m_memory, this);
+		if(buffer.m_is_relocatable)
+			RenderCore::Get().GetAllocator().SetRelocatable(buffer.m_memory, &buffer);
+		if(m_is_relocatable || buffer.m_is_relocatable)
+			RenderCore::Get().GetAllocator().GetDefragmenter().SwapOwners(this, &buffer);
+		return *this;
+	}
+
+	void VertexBuffer::SetData(CPUBuffer data, std::size_t offset)
+	{
+		if(offset + data.GetSize() > m_memory.size)
+		{
+			Error("Vulkan: trying to store to much data in a vertex buffer (% bytes at offset % in % bytes)", data.GetSize(), offset, m_memory.size);
 			return;
 		}
 		if(data.Empty())
@@ -127,17 +209,14 @@ namespace Scop
 			Warning("Vulkan: cannot set empty data in a vertex buffer");
 			return;
 		}
-		GPUBuffer staging;
-		staging.Init(BufferType::Staging, data.GetSize(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, data);
-		CopyFrom(staging);
-		staging.Destroy();
+		Write(data.GetData(), data.GetSize(), offset);
 	}
 
-	void IndexBuffer::SetData(CPUBuffer data)
+	void IndexBuffer::SetData(CPUBuffer data, std::size_t offset)
 	{
-		if(data.GetSize() > m_memory.size)
+		if(offset + data.GetSize() > m_memory.size)
 		{
-			Error("Vulkan: trying to store to much data in an index buffer (% bytes in % bytes)", data.GetSize(), m_memory.size);
+			Error("Vulkan: trying to store to much data in an index buffer (% bytes at offset % in % bytes)", data.GetSize(), offset, m_memory.size);
 			return;
 		}
 		if(data.Empty())
@@ -145,37 +224,94 @@ namespace Scop
 			Warning("Vulkan: cannot set empty data in an index buffer");
 			return;
 		}
-		GPUBuffer staging;
-		staging.Init(BufferType::Staging, data.GetSize(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, data);
-		CopyFrom(staging);
-		staging.Destroy();
+		Write(data.GetData(), data.GetSize(), offset);
 	}
 
-	void UniformBuffer::Init(std::uint32_t size)
+	void UniformRingBuffer::Init(VkDeviceSize frame_size)
 	{
-		for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-		{
-			m_buffers[i].Init(BufferType::HighDynamic, size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, {});
-			m_maps[i] = m_buffers[i].GetMap();
-			if(m_maps[i] == nullptr)
-				FatalError("Vulkan: unable to map a uniform buffer");
-		}
+		VkPhysicalDeviceProperties properties;
+		RenderCore::Get().vkGetPhysicalDeviceProperties(RenderCore::Get().GetPhysicalDevice(), &properties);
+		m_alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 16);
+		m_frame_size = (frame_size + m_alignment - 1) & ~(m_alignment - 1);
+		m_buffer.Init(BufferType::HighDynamic, m_frame_size * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, {});
+		if(m_buffer.GetMap() == nullptr)
+			FatalError("Vulkan: unable to map the uniform ring buffer");
+		m_frame_begin = 0;
+		m_cursor = 0;
+		Message("Vulkan: uniform ring buffer created with % bytes per frame", m_frame_size);
 	}
 
-	void UniformBuffer::SetData(CPUBuffer data, std::size_t frame_index)
+	void UniformRingBuffer::BeginFrame(std::size_t frame_index) noexcept
 	{
-		if(data.GetSize() != m_buffers[frame_index].GetSize())
-		{
-			Error("Vulkan: invalid data size to update to a uniform buffer, % != %", data.GetSize(), m_buffers[frame_index].GetSize());
+		m_frame_begin = m_frame_size * frame_index;
+		m_cursor = m_frame_begin;
+	}
+
+	std::pair<void*, std::uint32_t> UniformRingBuffer::AllocateRaw(VkDeviceSize size)
+	{
+		VkDeviceSize aligned_size = (size + m_alignment - 1) & ~(m_alignment - 1);
+		if(m_cursor + aligned_size > m_frame_begin + m_frame_size)
+			FatalError("Vulkan: uniform ring buffer is full (% bytes per frame)", m_frame_size);
+		VkDeviceSize offset = m_cursor;
+		m_cursor += aligned_size;
+		return { static_cast<std::uint8_t*>(m_buffer.GetMap()) + offset, static_cast<std::uint32_t>(offset) };
+	}
+
+	void UniformRingBuffer::Destroy() noexcept
+	{
+		m_buffer.Destroy();
+	}
+
+	void IndirectDrawBuffer::Begin(std::size_t frame_index, std::size_t draw_count)
+	{
+		m_frame_index = frame_index;
+		m_cursor = 0;
+		GPUBuffer& buffer = m_buffers[frame_index];
+		std::size_t capacity = (buffer.IsInit() ? buffer.GetSize() / sizeof(VkDrawIndexedIndirectCommand) : 0);
+		if(draw_count <= capacity)
 			return;
+		// The previous use of this frame buffer is done, it can be replaced right away
+		buffer.Destroy();
+		capacity = std::max({ draw_count, capacity * 2, DEFAULT_INDIRECT_DRAW_CAPACITY });
+		buffer.Init(BufferType::HighDynamic, capacity * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, {});
+		if(buffer.GetMap() == nullptr)
+			FatalError("Vulkan: unable to map an indirect draw buffer");
+	}
+
+	std::size_t IndirectDrawBuffer::Draw(VkCommandBuffer cmd, const VkDrawIndexedIndirectCommand* commands, std::uint32_t count)
+	{
+		GPUBuffer& buffer = m_buffers[m_frame_index];
+		if(count == 0)
+			return 0;
+		if((m_cursor + count) * sizeof(VkDrawIndexedIndirectCommand) > buffer.GetSize())
+		{
+			Error("Vulkan: indirect draw buffer overflow, % commands were reserved", buffer.GetSize() / sizeof(VkDrawIndexedIndirectCommand));
+			return 0;
+		}
+		VkDeviceSize offset = m_cursor * sizeof(VkDrawIndexedIndirectCommand);
+		std::memcpy(static_cast<std::uint8_t*>(buffer.GetMap()) + offset, commands, count * sizeof(VkDrawIndexedIndirectCommand));
+		m_cursor += count;
+
+		// The object index is carried by firstInstance, which indirect draws may ignore
+		if(!RenderCore::Get().GetPhysicalDeviceFeatures().drawIndirectFirstInstance)
+		{
+			for(std::uint32_t i = 0; i < count; i++)
+				RenderCore::Get().vkCmdDrawIndexed(cmd, commands[i].indexCount, commands[i].instanceCount, commands[i].firstIndex, commands[i].vertexOffset, commands[i].firstInstance);
+			return count;
+		}
+		if(RenderCore::Get().GetPhysicalDeviceFeatures().multiDrawIndirect)
+		{
+			RenderCore::Get().vkCmdDrawIndexedIndirect(cmd, buffer.Get(), offset, count, sizeof(VkDrawIndexedIndirectCommand));
+			return 1;
 		}
-		if(m_maps[frame_index] != nullptr)
-			std::memcpy(m_maps[frame_index], data.GetData(), data.GetSize());
+		for(std::uint32_t i = 0; i < count; i++)
+			RenderCore::Get().vkCmdDrawIndexedIndirect(cmd, buffer.Get(), offset + i * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+		return count;
 	}
 
-	void UniformBuffer::Destroy() noexcept
+	void IndirectDrawBuffer::Destroy() noexcept
 	{
-		for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-			m_buffers[i].Destroy();
+		for(GPUBuffer& buffer : m_buffers)
+			buffer.Destroy();
 	}
 }
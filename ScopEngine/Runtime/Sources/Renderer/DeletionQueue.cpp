@@ -0,0 +1,41 @@
+#include <Renderer/DeletionQueue.h>
+#include <Renderer/RenderCore.h>
+
+namespace Scop
+{
+	void DeletionQueue::BeginFrame() noexcept
+	{
+		m_frame_counter++;
+		// An object released while recording a frame may be used by every frame in flight at that time.
+		// Batch values only grow, an entry whose batches are pending holds back the ones after it
+		while(!m_pending.empty() && m_pending.front().frame + MAX_FRAMES_IN_FLIGHT <= m_frame_counter)
+		{
+			if(!RenderCore::Get().GetUploadContext().IsComplete(m_pending.front().upload_value) || !RenderCore::Get().GetOneShotCommands().IsComplete(m_pending.front().one_shot_value))
+				break;
+			// Deleters may release other objects, the front is popped before running it
+			std::function<void()> deleter = std::move(m_pending.front().deleter);
+			m_pending.pop_front();
+			deleter();
+		}
+	}
+
+	void DeletionQueue::Push(std::function<void()> deleter)
+	{
+		Push(std::move(deleter), RenderCore::Get().GetUploadContext().GetCurrentBatchValue(), RenderCore::Get().GetOneShotCommands().GetCurrentBatchValue());
+	}
+
+	void DeletionQueue::Push(std::function<void()> deleter, std::uint64_t upload_value, std::uint64_t one_shot_value)
+	{
+		m_pending.push_back({ std::move(deleter), m_frame_counter, upload_value, one_shot_value });
+	}
+
+	void DeletionQueue::Flush() noexcept
+	{
+		while(!m_pending.empty())
+		{
+			std::function<void()> deleter = std::move(m_pending.front().deleter);
+			m_pending.pop_front();
+			deleter();
+		}
+	}
+}
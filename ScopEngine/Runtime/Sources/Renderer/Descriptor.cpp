@@ -22,6 +22,124 @@ namespace Scop
 			Error("Vulkan: cannot transition descriptor image layout, unkown image type");
 	}
 
+	void DescriptorAllocator::BeginFrame(std::size_t frame_index) noexcept
+	{
+		m_frame_index = frame_index;
+		for(VkDescriptorPool pool : m_transient_pools[frame_index].pools)
+			RenderCore::Get().vkResetDescriptorPool(RenderCore::Get().GetDevice(), pool, 0);
+		m_transient_pools[frame_index].current = 0;
+	}
+
+	VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout, const std::vector<Descriptor>& descriptors)
+	{
+		auto it = m_free_sets.find(layout);
+		if(it != m_free_sets.end() && !it->second.empty())
+		{
+			VkDescriptorSet set = it->second.back();
+			it->second.pop_back();
+			return set;
+		}
+		return AllocateFromPools(m_pools, DEFAULT_DESCRIPTOR_POOL_SET_COUNT, layout, descriptors);
+	}
+
+	void DescriptorAllocator::Release(VkDescriptorSetLayout layout, VkDescriptorSet set)
+	{
+		if(set == VK_NULL_HANDLE)
+			return;
+		std::uint64_t generation = m_layout_generations[layout];
+		RenderCore::Get().GetDeletionQueue().Push([this, layout, set, generation]
+		{
+			if(m_layout_generations[layout] == generation)
+				m_free_sets[layout].push_back(set);
+		});
+	}
+
+	VkDescriptorSet DescriptorAllocator::AllocateTransient(VkDescriptorSetLayout layout, const std::vector<Descriptor>& descriptors)
+	{
+		return AllocateFromPools(m_transient_pools[m_frame_index], DEFAULT_TRANSIENT_DESCRIPTOR_POOL_SET_COUNT, layout, descriptors);
+	}
+
+	void DescriptorAllocator::ForgetLayout(VkDescriptorSetLayout layout) noexcept
+	{
+		// The sets stay in their pool, they are only lost until the allocator is destroyed
+		m_free_sets.erase(layout);
+		m_layout_generations[layout]++;
+	}
+
+	VkDescriptorSet DescriptorAllocator::AllocateFromPools(PoolList& list, std::uint32_t set_count, VkDescriptorSetLayout layout, const std::vector<Descriptor>& descriptors)
+	{
+		m_set_usage++;
+		for(const Descriptor& descriptor : descriptors)
+			m_descriptor_usage[descriptor.type]++;
+
+		VkDescriptorSetAllocateInfo alloc_info{};
+		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		alloc_info.descriptorSetCount = 1;
+		alloc_info.pSetLayouts = &layout;
+
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		for(; list.current < list.pools.size(); list.current++)
+		{
+			alloc_info.descriptorPool = list.pools[list.current];
+			VkResult result = RenderCore::Get().vkAllocateDescriptorSets(RenderCore::Get().GetDevice(), &alloc_info, &set);
+			if(result == VK_SUCCESS)
+				return set;
+			if(result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+				FatalError("Vulkan: failed to allocate a descriptor set, %", kvfVerbaliseVkResult(result));
+		}
+		list.pools.push_back(CreatePool(set_count, descriptors));
+		list.current = list.pools.size() - 1;
+		alloc_info.descriptorPool = list.pools.back();
+		VkResult result = RenderCore::Get().vkAllocateDescriptorSets(RenderCore::Get().GetDevice(), &alloc_info, &set);
+		if(result != VK_SUCCESS)
+			FatalError("Vulkan: failed to allocate a descriptor set, %", kvfVerbaliseVkResult(result));
+		return set;
+	}
+
+	VkDescriptorPool DescriptorAllocator::CreatePool(std::uint32_t set_count, const std::vector<Descriptor>& descriptors)
+	{
+		// Each type gets its share of the descriptors allocated so far, and at least enough for the requesting layout
+		std::unordered_map<VkDescriptorType, std::uint32_t> layout_usage;
+		for(const Descriptor& descriptor : descriptors)
+			layout_usage[descriptor.type]++;
+		std::vector<VkDescriptorPoolSize> pool_sizes;
+		for(auto [type, count] : m_descriptor_usage)
+		{
+			VkDescriptorPoolSize size{};
+			size.type = type;
+			size.descriptorCount = std::max<std::uint32_t>((count * set_count + m_set_usage - 1) / m_set_usage, layout_usage[type]);
+			pool_sizes.push_back(size);
+		}
+
+		VkDescriptorPoolCreateInfo pool_info{};
+		pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		pool_info.poolSizeCount = pool_sizes.size();
+		pool_info.pPoolSizes = pool_sizes.data();
+		pool_info.maxSets = set_count;
+
+		VkDescriptorPool pool = VK_NULL_HANDLE;
+		if(RenderCore::Get().vkCreateDescriptorPool(RenderCore::Get().GetDevice(), &pool_info, nullptr, &pool) != VK_SUCCESS)
+			FatalError("Vulkan: failed to create a descriptor pool");
+		Message("Vulkan: descriptor pool created (% sets)", set_count);
+		return pool;
+	}
+
+	void DescriptorAllocator::Destroy() noexcept
+	{
+		for(VkDescriptorPool pool : m_pools.pools)
+			RenderCore::Get().vkDestroyDescriptorPool(RenderCore::Get().GetDevice(), pool, nullptr);
+		m_pools = {};
+		for(PoolList& list : m_transient_pools)
+		{
+			for(VkDescriptorPool pool : list.pools)
+				RenderCore::Get().vkDestroyDescriptorPool(RenderCore::Get().GetDevice(), pool, nullptr);
+			list = {};
+		}
+		m_free_sets.clear();
+		m_layout_generations.clear();
+		Message("Vulkan: descriptor pools destroyed");
+	}
+
 	DescriptorSet::DescriptorSet(const ShaderSetLayout& layout, VkDescriptorSetLayout vklayout, ShaderType shader_type)
 	: m_set_layout(vklayout)
 	{
@@ -32,15 +150,53 @@ namespace Scop
 			m_descriptors.back().shader_type = shader_type;
 			m_descriptors.back().binding = binding;
 		}
+		Verify(m_descriptors.size() <= MAX_DESCRIPTOR_SET_BINDINGS, "too many descriptor set bindings");
 		for(std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-			m_set[i] = kvfAllocateDescriptorSet(RenderCore::Get().GetDevice(), vklayout);
+			m_set[i] = RenderCore::Get().GetDescriptorAllocator().Allocate(vklayout, m_descriptors);
 	}
 
 	DescriptorSet::DescriptorSet(VkDescriptorSetLayout layout, const std::vector<Descriptor>& descriptors)
-	: m_set_layout(layout), m_descriptors(descriptors)
+	: m_descriptors(descriptors), m_set_layout(layout)
 	{
+		// The new sets hold nothing yet
+		for(Descriptor& descriptor : m_descriptors)
+			descriptor.written_states.fill({});
 		for(std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-			m_set[i] = kvfAllocateDescriptorSet(RenderCore::Get().GetDevice(), layout);
+			m_set[i] = RenderCore::Get().GetDescriptorAllocator().Allocate(layout, m_descriptors);
+	}
+
+	DescriptorSet::DescriptorSet(DescriptorSet&& set) noexcept
+	: m_descriptors(std::move(set.m_descriptors)), m_set(set.m_set), m_set_layout(set.m_set_layout)
+	{
+		set.m_set.fill(VK_NULL_HANDLE);
+	}
+
+	DescriptorSet& DescriptorSet::operator=(DescriptorSet&& set) noexcept
+	{
+		if(this == &set)
+			return *this;
+		Release();
+		m_descriptors = std::move(set.m_descriptors);
+		m_set = set.m_set;
+		m_set_layout = set.m_set_layout;
+		set.m_set.fill(VK_NULL_HANDLE);
+		return *this;
+	}
+
+	void DescriptorSet::Release() noexcept
+	{
+		// Sets outliving the render core were freed with its pools
+		if(IsInit() && RenderCore::IsInit())
+		{
+			for(VkDescriptorSet set : m_set)
+				RenderCore::Get().GetDescriptorAllocator().Release(m_set_layout, set);
+		}
+		m_set.fill(VK_NULL_HANDLE);
+	}
+
+	DescriptorSet::~DescriptorSet()
+	{
+		Release();
 	}
 
 	void DescriptorSet::SetImage(std::size_t i, std::uint32_t binding, class Image& image)
@@ -60,6 +216,8 @@ namespace Scop
 			Error("Vulkan: trying to bind an image to the wrong descriptor");
 			return;
 		}
+		if(it->image_ptr.Get() != &image)
+			it->version++;
 		it->image_ptr = &image;
 	}
 
@@ -80,10 +238,12 @@ namespace Scop
 			Error("Vulkan: trying to bind a buffer to the wrong descriptor");
 			return;
 		}
+		if(it->storage_buffer_ptr.Get() != &buffer)
+			it->version++;
 		it->storage_buffer_ptr = &buffer;
 	}
 
-	void DescriptorSet::SetUniformBuffer(std::size_t i, std::uint32_t binding, class GPUBuffer& buffer)
+	void DescriptorSet::SetUniformBuffer(std::size_t i, std::uint32_t binding, class GPUBuffer& buffer, VkDeviceSize range)
 	{
 		Verify(m_set[i] != VK_NULL_HANDLE, "invalid descriptor");
 		auto it = std::find_if(m_descriptors.begin(), m_descriptors.end(), [=](Descriptor descriptor)
@@ -95,73 +255,86 @@ namespace Scop
 			Warning("Vulkan: cannot update descriptor set buffer; invalid binding");
 			return;
 		}
-		if(it->type != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+		if(it->type != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER && it->type != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
 		{
 			Error("Vulkan: trying to bind a buffer to the wrong descriptor");
 			return;
 		}
+		if(it->type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC && range == VK_WHOLE_SIZE)
+		{
+			Error("Vulkan: dynamic uniform buffers need the range of their data");
+			return;
+		}
+		if(it->uniform_buffer_ptr.Get() != &buffer || it->range != range)
+			it->version++;
 		it->uniform_buffer_ptr = &buffer;
+		it->range = range;
 	}
 
 	void DescriptorSet::Update(std::size_t i, VkCommandBuffer cmd) noexcept
 	{
 		Verify(m_set[i] != VK_NULL_HANDLE, "invalid descriptor");
 
-		std::size_t image_count = 0;
-		std::size_t buffer_count = 0;
+		std::array<VkWriteDescriptorSet, MAX_DESCRIPTOR_SET_BINDINGS> writes;
+		std::array<VkDescriptorBufferInfo, MAX_DESCRIPTOR_SET_BINDINGS> buffer_infos;
+		std::array<VkDescriptorImageInfo, MAX_DESCRIPTOR_SET_BINDINGS> image_infos;
+		std::uint32_t write_count = 0;
 
 		for(auto& descriptor : m_descriptors)
 		{
+			DescriptorState state{};
+			state.version = descriptor.version;
 			if(descriptor.image_ptr)
-				image_count++;
-			else if(descriptor.uniform_buffer_ptr || descriptor.storage_buffer_ptr)
-				buffer_count++;
+			{
+				// The layout may have changed since the last frame even if the descriptor did not
+				TransitionImageToCorrectLayout(*descriptor.image_ptr, cmd);
+				state.image_view = descriptor.image_ptr->GetImageView();
+				state.sampler = descriptor.image_ptr->GetSampler();
+				state.image_layout = descriptor.image_ptr->GetLayout();
+			}
+			else if(descriptor.uniform_buffer_ptr)
+			{
+				state.buffer = descriptor.uniform_buffer_ptr->Get();
+				state.range = descriptor.range;
+			}
+			else if(descriptor.storage_buffer_ptr)
+			{
+				state.buffer = descriptor.storage_buffer_ptr->Get();
+				state.range = VK_WHOLE_SIZE;
+			}
 			else
 				FatalError("unknown descriptor data");
-		}
 
-		std::vector<VkWriteDescriptorSet> writes(m_descriptors.size());
-		std::vector<VkDescriptorBufferInfo> buffer_infos(buffer_count);
-		std::vector<VkDescriptorImageInfo> image_infos(image_count);
-		std::size_t buffer_index = 0;
-		std::size_t image_index = 0;
-		std::size_t write_index = 0;
+			if(descriptor.written_states[i] == state)
+				continue;
+			descriptor.written_states[i] = state;
 
-		for(auto& descriptor : m_descriptors)
-		{
 			if(descriptor.image_ptr)
 			{
-				TransitionImageToCorrectLayout(*descriptor.image_ptr, cmd);
 				VkDescriptorImageInfo info{};
-				info.sampler = descriptor.image_ptr->GetSampler();
-				info.imageLayout = descriptor.image_ptr->GetLayout();
-				info.imageView = descriptor.image_ptr->GetImageView();
-				image_infos[image_index] = std::move(info);
-				writes[write_index] = kvfWriteImageToDescriptorSet(RenderCore::Get().GetDevice(), m_set[i], &image_infos[image_index], descriptor.binding);
-				image_index++;
+				info.sampler = state.sampler;
+				info.imageLayout = state.image_layout;
+				info.imageView = state.image_view;
+				image_infos[write_count] = info;
+				writes[write_count] = kvfWriteImageToDescriptorSet(RenderCore::Get().GetDevice(), m_set[i], &image_infos[write_count], descriptor.binding);
 			}
-			else if(descriptor.uniform_buffer_ptr)
-			{
-				VkDescriptorBufferInfo info{};
-				info.buffer = descriptor.uniform_buffer_ptr->Get();
-				info.offset = descriptor.uniform_buffer_ptr->GetOffset();
-				info.range = VK_WHOLE_SIZE;
-				buffer_infos[buffer_index] = std::move(info);
-				writes[write_index] = kvfWriteUniformBufferToDescriptorSet(RenderCore::Get().GetDevice(), m_set[i], &buffer_infos[buffer_index], descriptor.binding);
-				buffer_index++;
-			}
-			else if(descriptor.storage_buffer_ptr)
+			else
 			{
+				GPUBuffer& buffer = descriptor.uniform_buffer_ptr ? *descriptor.uniform_buffer_ptr : *descriptor.storage_buffer_ptr;
 				VkDescriptorBufferInfo info{};
-				info.buffer = descriptor.storage_buffer_ptr->Get();
-				info.offset = descriptor.storage_buffer_ptr->GetOffset();
-				info.range = VK_WHOLE_SIZE;
-				buffer_infos[buffer_index] = std::move(info);
-				writes[write_index] = kvfWriteStorageBufferToDescriptorSet(RenderCore::Get().GetDevice(), m_set[i], &buffer_infos[buffer_index], descriptor.binding);
-				buffer_index++;
+				info.buffer = state.buffer;
+				info.offset = buffer.GetOffset();
+				info.range = state.range;
+				buffer_infos[write_count] = info;
+				if(descriptor.uniform_buffer_ptr)
+					writes[write_count] = kvfWriteUniformBufferToDescriptorSet(RenderCore::Get().GetDevice(), m_set[i], &buffer_infos[write_count], descriptor.binding);
+				else
+					writes[write_count] = kvfWriteStorageBufferToDescriptorSet(RenderCore::Get().GetDevice(), m_set[i], &buffer_infos[write_count], descriptor.binding);
+				writes[write_count].descriptorType = descriptor.type;
 			}
-			write_index++;
+			write_count++;
 		}
-		RenderCore::Get().vkUpdateDescriptorSets(RenderCore::Get().GetDevice(), writes.size(), writes.data(), 0, nullptr);
+		if(write_count != 0)
+			RenderCore::Get().vkUpdateDescriptorSets(RenderCore::Get().GetDevice(), write_count, writes.data(), 0, nullptr);
 	}
 }
@@ -0,0 +1,55 @@
+#include <Renderer/FrameArena.h>
+
+#include <bit>
+#include <new>
+
+namespace Scop
+{
+	void FrameArena::Init(std::size_t region_size)
+	{
+		for(Region& region : m_regions)
+		{
+			region.memory = std::make_unique_for_overwrite<std::byte[]>(region_size);
+			region.size = region_size;
+		}
+		m_frame_index = 0;
+	}
+
+	void FrameArena::BeginFrame(std::size_t frame_index) noexcept
+	{
+		m_frame_index = frame_index;
+		Region& region = m_regions[frame_index];
+		// The region grows to what the frame needed so the next ones fit without overflowing
+		if(region.overflow_size != 0)
+		{
+			std::size_t new_size = std::bit_ceil(region.size + region.overflow_size);
+			region.overflow.clear();
+			region.memory.reset(new(std::nothrow) std::byte[new_size]);
+			region.size = (region.memory ? new_size : 0);
+			region.overflow_size = 0;
+		}
+		region.offset = 0;
+	}
+
+	void* FrameArena::do_allocate(std::size_t bytes, std::size_t alignment)
+	{
+		Region& region = m_regions[m_frame_index];
+		std::size_t aligned_offset = (region.offset + alignment - 1) & ~(alignment - 1);
+		if(region.memory && aligned_offset + bytes <= region.size)
+		{
+			region.offset = aligned_offset + bytes;
+			return region.memory.get() + aligned_offset;
+		}
+		std::size_t size = bytes + alignment;
+		std::byte* memory = region.overflow.emplace_back(std::make_unique_for_overwrite<std::byte[]>(size)).get();
+		region.overflow_size += size;
+		void* ptr = memory;
+		return std::align(alignment, bytes, ptr, size);
+	}
+
+	void FrameArena::Destroy() noexcept
+	{
+		for(Region& region : m_regions)
+			region = Region{};
+	}
+}
@@ -0,0 +1,141 @@
+#include <Renderer/GeometryHeap.h>
+#include <Renderer/Vertex.h>
+#include <Core/Logs.h>
+
+#include <algorithm>
+
+namespace Scop
+{
+	void GeometryHeap::RangeAllocator::Init(std::uint32_t capacity)
+	{
+		m_free_ranges.clear();
+		m_free_ranges.emplace(0, capacity);
+	}
+
+	std::optional<std::uint32_t> GeometryHeap::RangeAllocator::Allocate(std::uint32_t count) noexcept
+	{
+		for(auto it = m_free_ranges.begin(); it != m_free_ranges.end(); ++it)
+		{
+			if(it->second < count)
+				continue;
+			std::uint32_t offset = it->first;
+			std::uint32_t remaining = it->second - count;
+			m_free_ranges.erase(it);
+			if(remaining != 0)
+				m_free_ranges.emplace(offset + count, remaining);
+			return offset;
+		}
+		return std::nullopt;
+	}
+
+	void GeometryHeap::RangeAllocator::Free(std::uint32_t offset, std::uint32_t count) noexcept
+	{
+		auto it = m_free_ranges.emplace(offset, count).first;
+		auto next = std::next(it);
+		if(next != m_free_ranges.end() && it->first + it->second == next->first)
+		{
+			it->second += next->second;
+			m_free_ranges.erase(next);
+		}
+		if(it != m_free_ranges.begin())
+		{
+			auto prev = std::prev(it);
+			if(prev->first + prev->second == it->first)
+			{
+				prev->second += it->second;
+				m_free_ranges.erase(it);
+			}
+		}
+	}
+
+	GeometryHeap::Allocation GeometryHeap::Allocate(CPUBuffer vertices, CPUBuffer indices)
+	{
+		std::uint32_t vertex_count = vertices.GetSize() / sizeof(Vertex);
+		std::uint32_t index_count = indices.GetSize() / sizeof(std::uint32_t);
+		if(vertex_count == 0 || index_count == 0)
+		{
+			Warning("Renderer: trying to allocate empty geometry");
+			return {};
+		}
+
+		Allocation allocation{};
+		allocation.vertex_count = vertex_count;
+		allocation.index_count = index_count;
+
+		Page* page = nullptr;
+		for(std::uint32_t i = 0; i < m_pages.size() && page == nullptr; i++)
+		{
+			std::optional<std::uint32_t> vertex_offset = m_pages[i].vertices.Allocate(vertex_count);
+			if(!vertex_offset.has_value())
+				continue;
+			std::optional<std::uint32_t> first_index = m_pages[i].indices.Allocate(index_count);
+			if(!first_index.has_value())
+			{
+				m_pages[i].vertices.Free(*vertex_offset, vertex_count);
+				continue;
+			}
+			page = &m_pages[i];
+			allocation.page = i;
+			allocation.vertex_offset = *vertex_offset;
+			allocation.first_index = *first_index;
+		}
+		if(page == nullptr)
+		{
+			// Geometry bigger than a default page gets a page of its own size
+			allocation.page = m_pages.size();
+			page = &CreatePage(std::max(vertex_count, DEFAULT_GEOMETRY_PAGE_VERTEX_COUNT), std::max(index_count, DEFAULT_GEOMETRY_PAGE_INDEX_COUNT));
+			allocation.vertex_offset = *page->vertices.Allocate(vertex_count);
+			allocation.first_index = *page->indices.Allocate(index_count);
+		}
+
+		page->vbo.SetData(std::move(vertices), static_cast<std::size_t>(allocation.vertex_offset) * sizeof(Vertex));
+		page->ibo.SetData(std::move(indices), static_cast<std::size_t>(allocation.first_index) * sizeof(std::uint32_t));
+		return allocation;
+	}
+
+	void GeometryHeap::Free(Allocation& allocation) noexcept
+	{
+		if(!allocation.IsValid() || allocation.page >= m_pages.size())
+			return;
+		// Frames in flight may still read the geometry, a new allocation would overwrite it
+		RenderCore::Get().GetDeletionQueue().Push([this, allocation]{ Release(allocation); });
+		allocation = {};
+	}
+
+	void GeometryHeap::Release(const Allocation& allocation) noexcept
+	{
+		// The heap may have been destroyed with ranges still pending
+		if(allocation.page >= m_pages.size())
+			return;
+		m_pages[allocation.page].vertices.Free(allocation.vertex_offset, allocation.vertex_count);
+		m_pages[allocation.page].indices.Free(allocation.first_index, allocation.index_count);
+	}
+
+	void GeometryHeap::Bind(VkCommandBuffer cmd, std::uint32_t page) const noexcept
+	{
+		Verify(page < m_pages.size(), "invalid geometry page");
+		m_pages[page].vbo.Bind(cmd);
+		m_pages[page].ibo.Bind(cmd);
+	}
+
+	GeometryHeap::Page& GeometryHeap::CreatePage(std::uint32_t vertex_count, std::uint32_t index_count)
+	{
+		Page& page = m_pages.emplace_back();
+		page.vbo.Init(vertex_count * sizeof(Vertex));
+		page.ibo.Init(index_count * sizeof(std::uint32_t));
+		page.vertices.Init(vertex_count);
+		page.indices.Init(index_count);
+		Message("Renderer: geometry page created (% vertices, % indices)", vertex_count, index_count);
+		return page;
+	}
+
+	void GeometryHeap::Destroy() noexcept
+	{
+		for(Page& page : m_pages)
+		{
+			page.vbo.Destroy();
+			page.ibo.Destroy();
+		}
+		m_pages.clear();
+	}
+}
@@ -1,9 +1,12 @@
 #include <Renderer/Image.h>
 #include <Renderer/RenderCore.h>
+#include <Renderer/BindlessTable.h>
 #include <Core/Logs.h>
 
 namespace Scop
 {
+	constexpr VkDeviceSize DEDICATED_ATTACHMENT_MIN_SIZE = 8ull * 1024 * 1024;
+
 	void Image::Init(ImageType type, std::uint32_t width, std::uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, bool is_multisampled)
 	{
 		m_type = type;
@@ -11,6 +14,7 @@ namespace Scop
 		m_height = height;
 		m_format = format;
 		m_tiling = tiling;
+		m_usage = usage;
 		m_is_multisampled = is_multisampled;
 
 		KvfImageType kvf_type = KVF_IMAGE_OTHER;
@@ -45,10 +49,30 @@ namespace Scop
 			m_image = kvfCreateImage(RenderCore::Get().GetDevice(), width, height, format, tiling, usage, kvf_type);
 
 		VkMemoryRequirements mem_requirements;
-		RenderCore::Get().vkGetImageMemoryRequirements(RenderCore::Get().GetDevice(), m_image, &mem_requirements);
+		bool dedicated = false;
+		if(RenderCore::Get().GetAllocator().HasDedicatedAllocationExtension())
+		{
+			VkMemoryDedicatedRequirementsKHR dedicated_requirements{};
+			dedicated_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS_KHR;
+			VkMemoryRequirements2KHR mem_requirements2{};
+			mem_requirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2_KHR;
+			mem_requirements2.pNext = &dedicated_requirements;
+			VkImageMemoryRequirementsInfo2KHR info{};
+			info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2_KHR;
+			info.image = m_image;
+			RenderCore::Get().vkGetImageMemoryRequirements2KHR(RenderCore::Get().GetDevice(), &info, &mem_requirements2);
+			mem_requirements = mem_requirements2.memoryRequirements;
+			dedicated = dedicated_requirements.prefersDedicatedAllocation || dedicated_requirements.requiresDedicatedAllocation;
+		}
+		else
+			RenderCore::Get().vkGetImageMemoryRequirements(RenderCore::Get().GetDevice(), m_image, &mem_requirements);
+
+		if(usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT))
+			dedicated = dedicated || mem_requirements.size >= DEDICATED_ATTACHMENT_MIN_SIZE;
 
-		m_memory = RenderCore::Get().GetAllocator().Allocate(mem_requirements.size, mem_requirements.alignment, *FindMemoryType(mem_requirements.memoryTypeBits, properties), true);
-		RenderCore::Get().vkBindImageMemory(RenderCore::Get().GetDevice(), m_image, m_memory.memory, 0);
+		MemoryPool pool = (tiling == VK_IMAGE_TILING_OPTIMAL ? MemoryPool::Optimal : MemoryPool::Linear);
+		m_memory = RenderCore::Get().GetAllocator().Allocate(mem_requirements.size, mem_requirements.alignment, *FindMemoryType(mem_requirements.memoryTypeBits, properties), pool, dedicated, m_image);
+		RenderCore::Get().vkBindImageMemory(RenderCore::Get().GetDevice(), m_image, m_memory.memory, m_memory.offset);
 		Message("Vulkan: image created");
 		s_image_count++;
 	}
@@ -67,9 +91,9 @@ namespace Scop
 	{
 		if(new_layout == m_layout)
 			return;
-		bool is_single_time_cmd_buffer = (cmd == VK_NULL_HANDLE);
-		if(is_single_time_cmd_buffer)
-			cmd = kvfCreateCommandBuffer(RenderCore::Get().GetDevice());
+		// Without a command buffer the transition is batched with the other one shot commands
+		if(cmd == VK_NULL_HANDLE)
+			cmd = RenderCore::Get().GetOneShotCommands().Get();
 		KvfImageType kvf_type = KVF_IMAGE_OTHER;
 		switch(m_type)
 		{
@@ -79,7 +103,7 @@ namespace Scop
 
 			default: break;
 		}
-		kvfTransitionImageLayout(RenderCore::Get().GetDevice(), m_image, kvf_type, cmd, m_format, m_layout, new_layout, is_single_time_cmd_buffer);
+		kvfTransitionImageLayout(RenderCore::Get().GetDevice(), m_image, kvf_type, cmd, m_format, m_layout, new_layout, false);
 		m_layout = new_layout;
 	}
 
@@ -126,20 +150,116 @@ namespace Scop
 
 	void Image::Destroy() noexcept
 	{
-		DestroySampler();
-		DestroyImageView();
+		if(m_image == VK_NULL_HANDLE)
+		{
+			DestroySampler();
+			DestroyImageView();
+			s_image_count--;
+			return;
+		}
 
-		if(m_image != VK_NULL_HANDLE)
+		RenderCore::Get().GetBindlessTable().ReleaseTexture(*this);
+		if(m_is_relocatable)
 		{
-			RenderCore::Get().GetAllocator().Deallocate(m_memory);
-			m_memory = NULL_MEMORY_BLOCK;
-			kvfDestroyImage(RenderCore::Get().GetDevice(), m_image);
+			RenderCore::Get().GetAllocator().GetDefragmenter().CancelRelocation(this);
+			RenderCore::Get().GetAllocator().SetRelocatable(m_memory, nullptr);
 		}
-		Message("Vulkan: image destroyed");
+		m_is_relocatable = false;
+		// Frames in flight may still sample or render to the image, and pending uploads or one shot commands target it
+		RenderCore::Get().GetDeletionQueue().Push([image = m_image, image_view = m_image_view, sampler = m_sampler, memory = m_memory]()
+		{
+			if(sampler != VK_NULL_HANDLE)
+				kvfDestroySampler(RenderCore::Get().GetDevice(), sampler);
+			if(image_view != VK_NULL_HANDLE)
+				kvfDestroyImageView(RenderCore::Get().GetDevice(), image_view);
+			RenderCore::Get().GetAllocator().Deallocate(memory);
+			kvfDestroyImage(RenderCore::Get().GetDevice(), image);
+			Message("Vulkan: image destroyed");
+		});
+		m_sampler = VK_NULL_HANDLE;
+		m_image_view = VK_NULL_HANDLE;
+		m_memory = NULL_MEMORY_BLOCK;
 		m_image = VK_NULL_HANDLE;
 		s_image_count--;
 	}
 
+	void Image::Upload(const void* data, VkDeviceSize size, const VkBufferImageCopy* regions, std::uint32_t regions_count, VkImageLayout final_layout)
+	{
+		VkImageAspectFlags aspect = (m_type == ImageType::Depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT);
+		std::uint32_t layer_count = (m_type == ImageType::Cube ? 6 : 1);
+		RenderCore::Get().GetUploadContext().UploadImage(m_image, aspect, layer_count, final_layout, data, size, regions, regions_count, kvfFormatSize(m_format));
+		m_layout = final_layout;
+	}
+
+	void Image::MakeRelocatable() noexcept
+	{
+		if(m_image == VK_NULL_HANDLE || m_type != ImageType::Color || m_is_multisampled || !(m_usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) || !(m_usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+			return;
+		m_is_relocatable = true;
+		RenderCore::Get().GetAllocator().SetRelocatable(m_memory, this);
+	}
+
+	bool Image::Relocate(VkCommandBuffer cmd, const MemoryBlock& new_block)
+	{
+		if(m_layout != VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+			return false;
+		VkDevice device = RenderCore::Get().GetDevice();
+		VkImage new_image = kvfCreateImage(device, m_width, m_height, m_format, m_tiling, m_usage, KVF_IMAGE_COLOR);
+		VkMemoryRequirements mem_requirements;
+		RenderCore::Get().vkGetImageMemoryRequirements(device, new_image, &mem_requirements);
+		if(mem_requirements.size > new_block.size || new_block.offset % mem_requirements.alignment != 0)
+		{
+			kvfDestroyImage(device, new_image);
+			return false;
+		}
+		RenderCore::Get().vkBindImageMemory(device, new_image, new_block.memory, new_block.offset);
+
+		// The barrier on the old image also waits for the frames that were submitted before and still sample it
+		kvfTransitionImageLayout(device, m_image, KVF_IMAGE_COLOR, cmd, m_format, m_layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false);
+		kvfTransitionImageLayout(device, new_image, KVF_IMAGE_COLOR, cmd, m_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, false);
+
+		VkImageCopy region{};
+		region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.srcSubresource.layerCount = 1;
+		region.dstSubresource = region.srcSubresource;
+		region.extent = { m_width, m_height, 1 };
+		RenderCore::Get().vkCmdCopyImage(cmd, m_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, new_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+		kvfTransitionImageLayout(device, new_image, KVF_IMAGE_COLOR, cmd, m_format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false);
+
+		m_relocated_image = m_image;
+		m_relocated_image_view = m_image_view;
+		m_image = new_image;
+		m_memory = new_block;
+		m_image_view = kvfCreateImageView(device, m_image, m_format, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+		return true;
+	}
+
+	void Image::ReleaseRelocatedResources() noexcept
+	{
+		if(m_relocated_image_view != VK_NULL_HANDLE)
+			kvfDestroyImageView(RenderCore::Get().GetDevice(), m_relocated_image_view);
+		if(m_relocated_image != VK_NULL_HANDLE)
+			kvfDestroyImage(RenderCore::Get().GetDevice(), m_relocated_image);
+		m_relocated_image_view = VK_NULL_HANDLE;
+		m_relocated_image = VK_NULL_HANDLE;
+	}
+
+	void Image::RetireRelocatedResources() noexcept
+	{
+		if(m_relocated_image != VK_NULL_HANDLE)
+		{
+			RenderCore::Get().GetDeletionQueue().Push([image = m_relocated_image, image_view = m_relocated_image_view]()
+			{
+				if(image_view != VK_NULL_HANDLE)
+					kvfDestroyImageView(RenderCore::Get().GetDevice(), image_view);
+				kvfDestroyImage(RenderCore::Get().GetDevice(), image);
+			});
+		}
+		m_relocated_image_view = VK_NULL_HANDLE;
+		m_relocated_image = VK_NULL_HANDLE;
+	}
+
 	void CubeTexture::Init(CPUBuffer pixels, std::uint32_t width, std::uint32_t height, VkFormat format)
 	{
 		if(!pixels)
@@ -183,7 +303,7 @@ namespace Scop
 			}
 		}
 
-		CPUBuffer complete_data(size);
+		CPUBuffer complete_data(size, CPUBufferPolicy::HugePages);
 		std::uint32_t pointer_offset = 0;
 
 		const std::uint32_t face_order[6] = { 3, 1, 0, 5, 2, 4 };
@@ -199,8 +319,6 @@ namespace Scop
 		Image::CreateImageView(VK_IMAGE_VIEW_TYPE_CUBE, VK_IMAGE_ASPECT_COLOR_BIT, 6);
 		Image::CreateSampler();
 
-		GPUBuffer staging_buffer;
-		staging_buffer.Init(BufferType::Staging, complete_data.GetSize(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, complete_data);
 		std::vector<VkBufferImageCopy> buffer_copy_regions;
 		std::uint32_t offset = 0;
 
@@ -220,26 +338,6 @@ namespace Scop
 			offset += face_width * face_height * kvfFormatSize(format);
 		}
 
-		VkImageSubresourceRange subresource_range{};
-		subresource_range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		subresource_range.baseMipLevel = 0;
-		subresource_range.levelCount = 1;
-		subresource_range.layerCount = 6;
-
-		auto device = RenderCore::Get().GetDevice();
-
-		VkCommandBuffer cmd = kvfCreateCommandBuffer(device);
-		kvfBeginCommandBuffer(cmd, 0);
-		TransitionLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, cmd);
-		RenderCore::Get().vkCmdCopyBufferToImage(cmd, staging_buffer.Get(), Image::Get(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, buffer_copy_regions.size(), buffer_copy_regions.data());
-		TransitionLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, cmd);
-		kvfEndCommandBuffer(cmd);
-
-		VkFence fence = kvfCreateFence(device);
-		kvfSubmitSingleTimeCommandBuffer(device, cmd, KVF_GRAPHICS_QUEUE, fence);
-		kvfWaitForFence(device, fence);
-		kvfDestroyFence(device, fence);
-
-		staging_buffer.Destroy();
+		Upload(complete_data.GetData(), complete_data.GetSize(), buffer_copy_regions.data(), buffer_copy_regions.size(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 	}
 }
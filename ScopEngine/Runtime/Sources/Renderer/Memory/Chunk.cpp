@@ -2,20 +2,52 @@
 #include <Renderer/RenderCore.h>
 #include <Core/Logs.h>
 
+#include <bit>
 #include <algorithm>
 
 namespace Scop
 {
-	MemoryChunk::MemoryChunk(VkDevice device, VkPhysicalDevice physical, VkDeviceSize size, std::int32_t memory_type_index)
-		: m_device(device), m_physical(physical), m_size(size), m_memory_type_index(memory_type_index)
+	void MemoryStatistics::Merge(const MemoryStatistics& rhs) noexcept
+	{
+		allocated_bytes += rhs.allocated_bytes;
+		used_bytes += rhs.used_bytes;
+		largest_free_block = std::max(largest_free_block, rhs.largest_free_block);
+		chunk_count += rhs.chunk_count;
+		block_count += rhs.block_count;
+		free_block_count += rhs.free_block_count;
+		allocations_per_frame += rhs.allocations_per_frame;
+		deallocations_per_frame += rhs.deallocations_per_frame;
+	}
+
+	float MemoryStatistics::GetFragmentation() const noexcept
+	{
+		VkDeviceSize free_bytes = allocated_bytes - used_bytes;
+		if(free_bytes == 0)
+			return 0.0f;
+		return 1.0f - static_cast<float>(largest_free_block) / static_cast<float>(free_bytes);
+	}
+
+	MemoryChunk::MemoryChunk(VkDevice device, VkPhysicalDevice physical, VkDeviceSize size, std::int32_t memory_type_index, MemoryPool pool, bool dedicated, VkImage dedicated_image)
+		: m_device(device), m_physical(physical), m_size(size), m_memory_type_index(memory_type_index), m_pool(pool), m_dedicated(dedicated)
 	{
 		Verify(device != VK_NULL_HANDLE, "Memory Chunk : invalid device");
 		VkMemoryAllocateInfo alloc_info{};
 		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 		alloc_info.allocationSize = size;
 		alloc_info.memoryTypeIndex = m_memory_type_index;
+		VkMemoryDedicatedAllocateInfoKHR dedicated_info{};
+		if(dedicated_image != VK_NULL_HANDLE)
+		{
+			dedicated_info.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO_KHR;
+			dedicated_info.image = dedicated_image;
+			alloc_info.pNext = &dedicated_info;
+		}
+		// Out of memory is reported to the allocator through IsValid so it can try to recover
 		if(RenderCore::Get().vkAllocateMemory(m_device, &alloc_info, nullptr, &m_memory) != VK_SUCCESS)
-			FatalError("Vulkan: failed to allocate memory for a chunk");
+		{
+			m_memory = VK_NULL_HANDLE;
+			return;
+		}
 
 		VkPhysicalDeviceMemoryProperties properties;
 		RenderCore::Get().vkGetPhysicalDeviceMemoryProperties(m_physical, &properties);
@@ -24,71 +56,232 @@ namespace Scop
 			if(RenderCore::Get().vkMapMemory(m_device, m_memory, 0, VK_WHOLE_SIZE, 0, &p_map) != VK_SUCCESS)
 				FatalError("Vulkan: failed to map a host visible chunk");
 		}
-		MemoryBlock& block = m_blocks.emplace_back();
-		block.memory = m_memory;
-		block.offset = 0;
-		block.size = size;
-		block.free = true;
+		for(auto& free_lists : m_free_lists)
+			free_lists.fill(NULL_MEMORY_BLOCK_HANDLE);
+		m_sl_bitmaps.fill(0);
+		InsertFreeNode(CreateNode(0, size));
 	}
 
 	[[nodiscard]] std::optional<MemoryBlock> MemoryChunk::Allocate(VkDeviceSize size, VkDeviceSize alignment)
 	{
-		for(std::size_t i = 0; i < m_blocks.size(); i++)
-		{
-			if(!m_blocks[i].free || m_blocks[i].size < size)
-				continue;
-			VkDeviceSize offset_displacement = (m_blocks[i].offset % alignment > 0) ? alignment - m_blocks[i].offset % alignment : 0;
-			VkDeviceSize old_size_available = m_blocks[i].size - offset_displacement;
+		if(size == 0)
+			return std::nullopt;
+		if(alignment == 0)
+			alignment = 1;
+		auto align_up = [alignment](VkDeviceSize offset) { return (offset + alignment - 1) / alignment * alignment; };
 
-			if(size + offset_displacement <= m_blocks[i].size)
-			{
-				m_blocks[i].offset += offset_displacement;
-				m_blocks[i].size = size;
-				m_blocks[i].free = false;
-
-				if(p_map != nullptr)
-					m_blocks[i].map = reinterpret_cast<void*>(reinterpret_cast<std::uintptr_t>(p_map) + m_blocks[i].offset);
-
-				MemoryBlock new_block;
-				new_block.memory = m_memory;
-				new_block.offset = m_blocks[i].offset + size;
-				new_block.size = old_size_available - size;
-				new_block.free = true;
-
-				if(new_block.size > 0)
-					m_blocks.emplace(m_blocks.begin() + i + 1, new_block);
-				return m_blocks[i];
-			}
+		std::uint32_t handle = FindFreeNode(size);
+		if(handle != NULL_MEMORY_BLOCK_HANDLE && align_up(m_nodes[handle].offset) + size > m_nodes[handle].offset + m_nodes[handle].size)
+			handle = FindFreeNode(size + alignment - 1); // guaranteed to fit whatever the alignment of its offset is
+		if(handle == NULL_MEMORY_BLOCK_HANDLE)
+			return std::nullopt;
+		RemoveFreeNode(handle);
+
+		VkDeviceSize padding = align_up(m_nodes[handle].offset) - m_nodes[handle].offset;
+		if(padding > 0)
+		{
+			std::uint32_t padding_handle = CreateNode(m_nodes[handle].offset, padding);
+			m_nodes[padding_handle].prev_physical = m_nodes[handle].prev_physical;
+			m_nodes[padding_handle].next_physical = handle;
+			if(m_nodes[handle].prev_physical != NULL_MEMORY_BLOCK_HANDLE)
+				m_nodes[m_nodes[handle].prev_physical].next_physical = padding_handle;
+			m_nodes[handle].prev_physical = padding_handle;
+			m_nodes[handle].offset += padding;
+			m_nodes[handle].size -= padding;
+			InsertFreeNode(padding_handle);
 		}
-		return std::nullopt;
+		if(m_nodes[handle].size > size)
+		{
+			std::uint32_t remainder_handle = CreateNode(m_nodes[handle].offset + size, m_nodes[handle].size - size);
+			m_nodes[remainder_handle].prev_physical = handle;
+			m_nodes[remainder_handle].next_physical = m_nodes[handle].next_physical;
+			if(m_nodes[handle].next_physical != NULL_MEMORY_BLOCK_HANDLE)
+				m_nodes[m_nodes[handle].next_physical].prev_physical = remainder_handle;
+			m_nodes[handle].next_physical = remainder_handle;
+			m_nodes[handle].size = size;
+			InsertFreeNode(remainder_handle);
+		}
+
+		m_used_size += size;
+		m_nodes[handle].alignment = alignment;
+
+		MemoryBlock block;
+		block.memory = m_memory;
+		block.offset = m_nodes[handle].offset;
+		block.size = size;
+		block.handle = handle;
+		if(p_map != nullptr)
+			block.map = reinterpret_cast<void*>(reinterpret_cast<std::uintptr_t>(p_map) + block.offset);
+		return block;
 	}
 
 	void MemoryChunk::Deallocate(const MemoryBlock& block)
 	{
-		auto it = std::find(m_blocks.begin(), m_blocks.end(), block);
-		if(it == m_blocks.end())
+		std::uint32_t handle = block.handle;
+		if(block.memory != m_memory || handle >= m_nodes.size() || m_nodes[handle].free || m_nodes[handle].offset != block.offset)
 			FatalError("Memory Chunk : cannot deallocate a block that is owned by another chunk");
-		it->free = true;
+		m_used_size -= m_nodes[handle].size;
+		m_nodes[handle].owner = nullptr;
+
+		std::uint32_t prev = m_nodes[handle].prev_physical;
+		if(prev != NULL_MEMORY_BLOCK_HANDLE && m_nodes[prev].free)
+		{
+			RemoveFreeNode(prev);
+			m_nodes[prev].size += m_nodes[handle].size;
+			m_nodes[prev].next_physical = m_nodes[handle].next_physical;
+			if(m_nodes[handle].next_physical != NULL_MEMORY_BLOCK_HANDLE)
+				m_nodes[m_nodes[handle].next_physical].prev_physical = prev;
+			ReleaseNode(handle);
+			handle = prev;
+		}
+		std::uint32_t next = m_nodes[handle].next_physical;
+		if(next != NULL_MEMORY_BLOCK_HANDLE && m_nodes[next].free)
+		{
+			RemoveFreeNode(next);
+			m_nodes[handle].size += m_nodes[next].size;
+			m_nodes[handle].next_physical = m_nodes[next].next_physical;
+			if(m_nodes[next].next_physical != NULL_MEMORY_BLOCK_HANDLE)
+				m_nodes[m_nodes[next].next_physical].prev_physical = handle;
+			ReleaseNode(next);
+		}
+		InsertFreeNode(handle);
+	}
+
+	void MemoryChunk::SetOwner(const MemoryBlock& block, MemoryRelocatable* owner) noexcept
+	{
+		if(block.memory != m_memory || block.handle >= m_nodes.size() || m_nodes[block.handle].free)
+			return;
+		m_nodes[block.handle].owner = owner;
+	}
+
+	void MemoryChunk::MappingInsert(VkDeviceSize size, std::uint32_t& fl, std::uint32_t& sl) noexcept
+	{
+		if(size < SMALL_BLOCK_SIZE)
+		{
+			fl = 0;
+			sl = static_cast<std::uint32_t>(size);
+			return;
+		}
+		std::uint32_t msb = std::bit_width(size) - 1;
+		sl = static_cast<std::uint32_t>(size >> (msb - SL_INDEX_LOG2)) ^ SL_INDEX_COUNT;
+		fl = msb - SL_INDEX_LOG2 + 1;
+	}
+
+	void MemoryChunk::MappingSearch(VkDeviceSize size, std::uint32_t& fl, std::uint32_t& sl) noexcept
+	{
+		// Rounds the size up to the next list so that any block found in it is big enough
+		if(size >= SMALL_BLOCK_SIZE)
+			size += (VkDeviceSize{ 1 } << (std::bit_width(size) - 1 - SL_INDEX_LOG2)) - 1;
+		MappingInsert(size, fl, sl);
+	}
+
+	std::uint32_t MemoryChunk::FindFreeNode(VkDeviceSize size) const noexcept
+	{
+		std::uint32_t fl;
+		std::uint32_t sl;
+		MappingSearch(size, fl, sl);
+		if(fl >= FL_INDEX_COUNT)
+			return NULL_MEMORY_BLOCK_HANDLE;
 
-		bool end = false;
-		while(!end)
+		std::uint32_t sl_map = m_sl_bitmaps[fl] & (~std::uint32_t{ 0 } << sl);
+		if(sl_map == 0)
 		{
-			end = true;
-			for(auto it = m_blocks.begin(); it != m_blocks.end(); ++it)
+			std::uint64_t fl_map = (fl + 1 < FL_INDEX_COUNT ? m_fl_bitmap & (~std::uint64_t{ 0 } << (fl + 1)) : 0);
+			if(fl_map == 0)
+				return NULL_MEMORY_BLOCK_HANDLE;
+			fl = std::countr_zero(fl_map);
+			sl_map = m_sl_bitmaps[fl];
+		}
+		sl = std::countr_zero(sl_map);
+		return m_free_lists[fl][sl];
+	}
+
+	std::uint32_t MemoryChunk::CreateNode(VkDeviceSize offset, VkDeviceSize size)
+	{
+		std::uint32_t handle;
+		if(!m_recycled_nodes.empty())
+		{
+			handle = m_recycled_nodes.back();
+			m_recycled_nodes.pop_back();
+		}
+		else
+		{
+			handle = static_cast<std::uint32_t>(m_nodes.size());
+			m_nodes.emplace_back();
+		}
+		m_nodes[handle] = Node{};
+		m_nodes[handle].offset = offset;
+		m_nodes[handle].size = size;
+		return handle;
+	}
+
+	void MemoryChunk::ReleaseNode(std::uint32_t handle) noexcept
+	{
+		m_nodes[handle] = Node{};
+		m_recycled_nodes.push_back(handle);
+	}
+
+	void MemoryChunk::InsertFreeNode(std::uint32_t handle) noexcept
+	{
+		std::uint32_t fl;
+		std::uint32_t sl;
+		MappingInsert(m_nodes[handle].size, fl, sl);
+		std::uint32_t head = m_free_lists[fl][sl];
+		m_nodes[handle].free = true;
+		m_nodes[handle].prev_free = NULL_MEMORY_BLOCK_HANDLE;
+		m_nodes[handle].next_free = head;
+		if(head != NULL_MEMORY_BLOCK_HANDLE)
+			m_nodes[head].prev_free = handle;
+		m_free_lists[fl][sl] = handle;
+		m_sl_bitmaps[fl] |= std::uint32_t{ 1 } << sl;
+		m_fl_bitmap |= std::uint64_t{ 1 } << fl;
+	}
+
+	void MemoryChunk::RemoveFreeNode(std::uint32_t handle) noexcept
+	{
+		std::uint32_t fl;
+		std::uint32_t sl;
+		MappingInsert(m_nodes[handle].size, fl, sl);
+		Node& node = m_nodes[handle];
+		if(node.prev_free != NULL_MEMORY_BLOCK_HANDLE)
+			m_nodes[node.prev_free].next_free = node.next_free;
+		if(node.next_free != NULL_MEMORY_BLOCK_HANDLE)
+			m_nodes[node.next_free].prev_free = node.prev_free;
+		if(m_free_lists[fl][sl] == handle)
+		{
+			m_free_lists[fl][sl] = node.next_free;
+			if(node.next_free == NULL_MEMORY_BLOCK_HANDLE)
 			{
-				if(it->free && (it + 1)->free)
-				{
-					it->size = (it + 1)->offset + (it + 1)->size - it->offset;
-					m_blocks.erase(it + 1);
-					end = false;
-					break;
-				}
+				m_sl_bitmaps[fl] &= ~(std::uint32_t{ 1 } << sl);
+				if(m_sl_bitmaps[fl] == 0)
+					m_fl_bitmap &= ~(std::uint64_t{ 1 } << fl);
 			}
 		}
+		node.prev_free = NULL_MEMORY_BLOCK_HANDLE;
+		node.next_free = NULL_MEMORY_BLOCK_HANDLE;
+		node.free = false;
+	}
+
+	void MemoryChunk::AccumulateStatistics(MemoryStatistics& stats) const noexcept
+	{
+		stats.allocated_bytes += m_size;
+		stats.used_bytes += m_used_size;
+		stats.chunk_count++;
+		ForEachBlockRange([&stats](VkDeviceSize, VkDeviceSize size, bool free)
+		{
+			if(!free)
+			{
+				stats.block_count++;
+				return;
+			}
+			stats.free_block_count++;
+			stats.largest_free_block = std::max(stats.largest_free_block, size);
+		});
 	}
 
 	MemoryChunk::~MemoryChunk()
 	{
-		RenderCore::Get().vkFreeMemory(m_device, m_memory, nullptr);
+		if(m_memory != VK_NULL_HANDLE)
+			RenderCore::Get().vkFreeMemory(m_device, m_memory, nullptr);
 	}
 }
@@ -0,0 +1,160 @@
+#include <Renderer/Memory/Defragmenter.h>
+#include <Renderer/Memory/DeviceAllocator.h>
+#include <Renderer/RenderCore.h>
+#include <Renderer/FrameArena.h>
+#include <Core/Logs.h>
+
+#include <algorithm>
+
+namespace Scop
+{
+	constexpr float SPARSE_CHUNK_MAX_OCCUPANCY = 0.5f;
+	constexpr VkDeviceSize MAX_RELOCATION_BYTES_PER_FRAME = 8ull * 1024 * 1024;
+
+	void DeviceDefragmenter::Update()
+	{
+		m_frame++;
+		if(!m_relocations.empty())
+		{
+			if(m_frame >= m_retire_frame && RenderCore::Get().vkGetFenceStatus(RenderCore::Get().GetDevice(), m_fence) == VK_SUCCESS)
+				Retire();
+			return;
+		}
+		if(m_enabled)
+			StartRelocations();
+	}
+
+	void DeviceDefragmenter::CancelRelocation(MemoryRelocatable* owner) noexcept
+	{
+		auto it = std::find_if(m_relocations.begin(), m_relocations.end(), [owner](const Relocation& relocation) { return relocation.owner == owner; });
+		if(it == m_relocations.end())
+			return;
+		// The copies were submitted before the frames in flight, the deletion queue also waits for them
+		it->owner->RetireRelocatedResources();
+		RenderCore::Get().GetDeletionQueue().Push([&allocator = m_allocator, block = it->old_block]() { allocator.Deallocate(block); });
+		m_relocations.erase(it);
+	}
+
+	void DeviceDefragmenter::SwapOwners(MemoryRelocatable* lhs, MemoryRelocatable* rhs) noexcept
+	{
+		for(Relocation& relocation : m_relocations)
+		{
+			if(relocation.owner == lhs)
+				relocation.owner = rhs;
+			else if(relocation.owner == rhs)
+				relocation.owner = lhs;
+		}
+	}
+
+	void DeviceDefragmenter::Destroy() noexcept
+	{
+		if(!m_relocations.empty())
+		{
+			kvfWaitForFence(RenderCore::Get().GetDevice(), m_fence);
+			Retire();
+		}
+		if(m_fence != VK_NULL_HANDLE)
+			kvfDestroyFence(RenderCore::Get().GetDevice(), m_fence);
+		if(m_cmd != VK_NULL_HANDLE)
+			kvfDestroyCommandBuffer(RenderCore::Get().GetDevice(), m_cmd);
+		m_fence = VK_NULL_HANDLE;
+		m_cmd = VK_NULL_HANDLE;
+	}
+
+	void DeviceDefragmenter::Retire() noexcept
+	{
+		for(Relocation& relocation : m_relocations)
+		{
+			relocation.owner->ReleaseRelocatedResources();
+			m_relocated_bytes += relocation.old_block.size;
+			m_allocator.Deallocate(relocation.old_block);
+		}
+		m_relocations.clear();
+	}
+
+	void DeviceDefragmenter::StartRelocations()
+	{
+		struct BlockInfo
+		{
+			MemoryBlock block;
+			VkDeviceSize alignment;
+			MemoryRelocatable* owner;
+		};
+
+		MemoryChunk* source = nullptr;
+		float source_occupancy = SPARSE_CHUNK_MAX_OCCUPANCY;
+		for(auto& chunk : m_allocator.m_chunks)
+		{
+			if(chunk->IsDedicated() || chunk->IsEmpty())
+				continue;
+			float occupancy = static_cast<float>(chunk->GetUsedSize()) / static_cast<float>(chunk->GetSize());
+			if(occupancy >= source_occupancy)
+				continue;
+			VkDeviceSize free_elsewhere = 0;
+			for(auto& other : m_allocator.m_chunks)
+			{
+				if(other != chunk && !other->IsDedicated() && !other->IsEmpty() && other->GetMemoryTypeIndex() == chunk->GetMemoryTypeIndex() && other->GetPool() == chunk->GetPool())
+					free_elsewhere += other->GetSize() - other->GetUsedSize();
+			}
+			if(free_elsewhere < chunk->GetUsedSize())
+				continue;
+			bool movable = true;
+			chunk->ForEachUsedBlock([&movable](const MemoryBlock&, VkDeviceSize, MemoryRelocatable* owner) { movable = movable && owner != nullptr; });
+			if(!movable)
+				continue;
+			source = chunk.get();
+			source_occupancy = occupancy;
+		}
+		if(source == nullptr)
+			return;
+
+		std::pmr::vector<BlockInfo> blocks(&RenderCore::Get().GetFrameArena());
+		source->ForEachUsedBlock([&blocks](const MemoryBlock& block, VkDeviceSize alignment, MemoryRelocatable* owner) { blocks.push_back({ block, alignment, owner }); });
+
+		VkDevice device = RenderCore::Get().GetDevice();
+		VkDeviceSize moved_bytes = 0;
+		bool recording = false;
+		for(const BlockInfo& info : blocks)
+		{
+			if(moved_bytes + info.block.size > MAX_RELOCATION_BYTES_PER_FRAME && moved_bytes > 0)
+				break;
+			// Empty chunks are skipped to avoid moving blocks back and forth between retained chunks
+			std::optional<MemoryBlock> new_block = m_allocator.AllocateInExistingChunks(info.block.size, info.alignment, source->GetMemoryTypeIndex(), source->GetPool(), source, false);
+			if(!new_block.has_value())
+				break;
+			if(!recording)
+			{
+				if(m_cmd == VK_NULL_HANDLE)
+					m_cmd = kvfCreateCommandBuffer(device);
+				if(m_fence == VK_NULL_HANDLE)
+					m_fence = kvfCreateFence(device);
+				RenderCore::Get().vkResetCommandBuffer(m_cmd, 0);
+				kvfBeginCommandBuffer(m_cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+				recording = true;
+			}
+			if(!info.owner->Relocate(m_cmd, *new_block))
+			{
+				m_allocator.Deallocate(*new_block);
+				continue;
+			}
+			m_allocator.SetRelocatable(*new_block, info.owner);
+			m_relocations.push_back({ info.owner, info.block });
+			moved_bytes += info.block.size;
+		}
+		if(!recording)
+			return;
+
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		RenderCore::Get().vkCmdPipelineBarrier(m_cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		kvfEndCommandBuffer(m_cmd);
+		if(m_relocations.empty())
+			return;
+		// Submitted on the graphics queue before the frame, so the frame sees the relocated resources
+		kvfSubmitCommandBuffer(device, m_cmd, KVF_GRAPHICS_QUEUE, VK_NULL_HANDLE, VK_NULL_HANDLE, m_fence, nullptr);
+		m_retire_frame = m_frame + MAX_FRAMES_IN_FLIGHT;
+		DebugLog("Device Defragmenter: relocating % blocks (% bytes)", m_relocations.size(), moved_bytes);
+	}
+}
@@ -1,34 +1,110 @@
 #include <Renderer/Memory/DeviceAllocator.h>
-#include <Maths/Constants.h>
+#include <Renderer/RenderCore.h>
 #include <Core/Logs.h>
 
+#include <algorithm>
 #include <optional>
+#include <fstream>
 
 namespace Scop
 {
-	constexpr VkDeviceSize CHUNK_SIZE = MaxValue<std::uint16_t>();
+	constexpr VkDeviceSize SMALL_HEAP_MAX_SIZE = 1024ull * 1024 * 1024;
+	constexpr VkDeviceSize LARGE_HEAP_CHUNK_SIZE = 256ull * 1024 * 1024;
+	constexpr std::uint32_t CHUNK_SIZE_GROWTH_STEPS = 3; // first chunks of a memory type are 1/8, 1/4, 1/2 of the preferred size
+	constexpr VkDeviceSize DEFAULT_BUDGET_NUMERATOR = 8; // without VK_EXT_memory_budget, 80% of a heap is considered usable
+	constexpr VkDeviceSize DEFAULT_BUDGET_DENOMINATOR = 10;
+	constexpr const char* OUT_OF_MEMORY_REPORT_PATH = "scop_memory_report.json";
 
-	[[nodiscard]] MemoryBlock DeviceAllocator::Allocate(VkDeviceSize size, VkDeviceSize alignment, std::int32_t memory_type_index, bool dedicated_chunk)
+	void DeviceAllocator::AttachToDevice(VkDevice device, VkPhysicalDevice physical, bool has_memory_budget, bool has_dedicated_allocation) noexcept
+	{
+		m_device = device;
+		m_physical = physical;
+		m_has_memory_budget = has_memory_budget && RenderCore::Get().vkGetPhysicalDeviceMemoryProperties2KHR != nullptr;
+		m_has_dedicated_allocation = has_dedicated_allocation && RenderCore::Get().vkGetImageMemoryRequirements2KHR != nullptr;
+		RenderCore::Get().vkGetPhysicalDeviceMemoryProperties(m_physical, &m_memory_properties);
+		VkPhysicalDeviceProperties properties;
+		RenderCore::Get().vkGetPhysicalDeviceProperties(m_physical, &properties);
+		m_buffer_image_granularity = properties.limits.bufferImageGranularity;
+		m_heap_usage.fill(0);
+		m_frame_allocations.fill(0);
+		m_frame_deallocations.fill(0);
+		m_last_frame_allocations.fill(0);
+		m_last_frame_deallocations.fill(0);
+		for(std::uint32_t i = 0; i < m_memory_properties.memoryHeapCount; i++)
+		{
+			VkDeviceSize heap_size = m_memory_properties.memoryHeaps[i].size;
+			m_preferred_chunk_sizes[i] = (heap_size <= SMALL_HEAP_MAX_SIZE ? heap_size / 8 : LARGE_HEAP_CHUNK_SIZE);
+		}
+		if(m_has_memory_budget)
+			Message("Device Allocator: using VK_EXT_memory_budget");
+	}
+
+	void DeviceAllocator::DetachFromDevice() noexcept
+	{
+		m_defragmenter.Destroy();
+		m_chunks.clear();
+		m_heap_usage.fill(0);
+		m_allocations_count = 0;
+		m_device = VK_NULL_HANDLE;
+		m_physical = VK_NULL_HANDLE;
+	}
+
+	[[nodiscard]] MemoryBlock DeviceAllocator::Allocate(VkDeviceSize size, VkDeviceSize alignment, std::int32_t memory_type_index, MemoryPool pool, bool dedicated_chunk, VkImage dedicated_image)
 	{
 		Verify(m_device != VK_NULL_HANDLE, "invalid device");
 		Verify(m_physical != VK_NULL_HANDLE, "invalid physical device");
+		// No need to split the pools if the device does not care about linear and optimal resources aliasing
+		if(m_buffer_image_granularity <= 1)
+			pool = MemoryPool::Linear;
 		if(!dedicated_chunk)
 		{
-			for(auto& chunk : m_chunks)
+			std::optional<MemoryBlock> block = AllocateInExistingChunks(size, alignment, memory_type_index, pool);
+			if(block.has_value())
 			{
-				if(chunk->GetMemoryTypeIndex() == memory_type_index)
-				{
-					std::optional<MemoryBlock> block = chunk->Allocate(size, alignment);
-					if(block.has_value())
-						return *block;
-				}
+				m_frame_allocations[memory_type_index]++;
+				return *block;
 			}
 		}
-		m_chunks.emplace_back(std::make_unique<MemoryChunk>(m_device, m_physical, (CHUNK_SIZE < size + alignment ? size + alignment : CHUNK_SIZE), memory_type_index));
-		std::optional<MemoryBlock> block = m_chunks.back()->Allocate(size, alignment);
+
+		std::uint32_t heap_index = m_memory_properties.memoryTypes[memory_type_index].heapIndex;
+		VkDeviceSize chunk_size = (dedicated_chunk ? size : ComputeChunkSize(memory_type_index, pool, size + alignment));
+		MemoryBudget budget = GetHeapBudget(heap_index);
+		if(budget.usage + chunk_size > budget.budget)
+		{
+			ReleaseEmptyChunks(heap_index);
+			chunk_size = (dedicated_chunk ? size : size + alignment);
+			budget = GetHeapBudget(heap_index);
+			if(budget.usage + chunk_size > budget.budget)
+				Warning("Device Allocator: memory heap % is over budget (% / % bytes)", heap_index, budget.usage + chunk_size, budget.budget);
+		}
+
+		std::unique_ptr<MemoryChunk> chunk = CreateChunk(chunk_size, memory_type_index, pool, dedicated_chunk, dedicated_image);
+		if(!chunk->IsValid() && !dedicated_chunk && chunk_size > size + alignment)
+		{
+			Warning("Device Allocator: failed to allocate a chunk of % bytes, retrying with a smaller one", chunk_size);
+			chunk_size = size + alignment;
+			chunk = CreateChunk(chunk_size, memory_type_index, pool, dedicated_chunk, dedicated_image);
+		}
+		if(!chunk->IsValid())
+		{
+			ReleaseEmptyChunks(heap_index);
+			chunk = CreateChunk(chunk_size, memory_type_index, pool, dedicated_chunk, dedicated_image);
+		}
+		if(!chunk->IsValid())
+		{
+			if(DumpJsonReport(OUT_OF_MEMORY_REPORT_PATH))
+				Error("Device Allocator: out of device memory, block map written to %", OUT_OF_MEMORY_REPORT_PATH);
+			FatalError("Device Allocator: could not allocate a chunk of % bytes on heap %", chunk_size, heap_index);
+		}
+		m_chunks.push_back(std::move(chunk));
+		m_heap_usage[heap_index] += chunk_size;
 		m_allocations_count++;
+		std::optional<MemoryBlock> block = m_chunks.back()->Allocate(size, alignment);
 		if(block.has_value())
+		{
+			m_frame_allocations[memory_type_index]++;
 			return *block;
+		}
 		FatalError("Device Allocator: could not allocate a memory block");
 		return {}; // to avoid warnings
 	}
@@ -37,14 +113,228 @@ namespace Scop
 	{
 		Verify(m_device != VK_NULL_HANDLE, "invalid device");
 		Verify(m_physical != VK_NULL_HANDLE, "invalid physical device");
+		for(std::size_t i = 0; i < m_chunks.size(); i++)
+		{
+			if(!m_chunks[i]->Has(block))
+				continue;
+			m_chunks[i]->Deallocate(block);
+			m_frame_deallocations[m_chunks[i]->GetMemoryTypeIndex()]++;
+			if(!m_chunks[i]->IsEmpty())
+				return;
+			if(m_chunks[i]->IsDedicated() || m_empty_chunk_policy == EmptyChunkPolicy::Release)
+				ReleaseChunk(i);
+			else if(m_empty_chunk_policy == EmptyChunkPolicy::KeepOne)
+			{
+				std::int32_t type = m_chunks[i]->GetMemoryTypeIndex();
+				MemoryPool pool = m_chunks[i]->GetPool();
+				auto it = std::find_if(m_chunks.begin(), m_chunks.end(), [&](const auto& chunk)
+				{
+					return chunk.get() != m_chunks[i].get() && chunk->GetMemoryTypeIndex() == type && chunk->GetPool() == pool && !chunk->IsDedicated() && chunk->IsEmpty();
+				});
+				if(it != m_chunks.end())
+					ReleaseChunk(i);
+			}
+			return;
+		}
+		Error("Device Allocator: unable to free a block; could not find it's chunk");
+	}
+
+	void DeviceAllocator::SetRelocatable(const MemoryBlock& block, MemoryRelocatable* owner) noexcept
+	{
 		for(auto& chunk : m_chunks)
 		{
 			if(chunk->Has(block))
 			{
-				chunk->Deallocate(block);
+				// Dedicated chunks are never defragmented
+				if(!chunk->IsDedicated())
+					chunk->SetOwner(block, owner);
 				return;
 			}
 		}
-		Error("Device Allocator: unable to free a block; could not find it's chunk");
+	}
+
+	std::optional<MemoryBlock> DeviceAllocator::AllocateInExistingChunks(VkDeviceSize size, VkDeviceSize alignment, std::int32_t memory_type_index, MemoryPool pool, const MemoryChunk* excluded, bool allow_empty_chunks)
+	{
+		for(auto& chunk : m_chunks)
+		{
+			if(chunk.get() == excluded || chunk->IsDedicated() || chunk->GetMemoryTypeIndex() != memory_type_index || chunk->GetPool() != pool)
+				continue;
+			if(!allow_empty_chunks && chunk->IsEmpty())
+				continue;
+			std::optional<MemoryBlock> block = chunk->Allocate(size, alignment);
+			if(block.has_value())
+				return block;
+		}
+		return std::nullopt;
+	}
+
+	void DeviceAllocator::ReleaseEmptyChunks(std::int32_t heap_index)
+	{
+		for(std::size_t i = m_chunks.size(); i > 0; i--)
+		{
+			if(!m_chunks[i - 1]->IsEmpty())
+				continue;
+			if(heap_index >= 0 && m_memory_properties.memoryTypes[m_chunks[i - 1]->GetMemoryTypeIndex()].heapIndex != static_cast<std::uint32_t>(heap_index))
+				continue;
+			ReleaseChunk(i - 1);
+		}
+	}
+
+	MemoryBudget DeviceAllocator::GetHeapBudget(std::uint32_t heap_index) const noexcept
+	{
+		MemoryBudget budget;
+		if(m_has_memory_budget)
+		{
+			VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties{};
+			budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+			VkPhysicalDeviceMemoryProperties2 properties{};
+			properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+			properties.pNext = &budget_properties;
+			RenderCore::Get().vkGetPhysicalDeviceMemoryProperties2KHR(m_physical, &properties);
+			budget.usage = budget_properties.heapUsage[heap_index];
+			budget.budget = budget_properties.heapBudget[heap_index];
+		}
+		else
+		{
+			budget.usage = m_heap_usage[heap_index];
+			budget.budget = m_memory_properties.memoryHeaps[heap_index].size * DEFAULT_BUDGET_NUMERATOR / DEFAULT_BUDGET_DENOMINATOR;
+		}
+		return budget;
+	}
+
+	VkDeviceSize DeviceAllocator::ComputeChunkSize(std::int32_t memory_type_index, MemoryPool pool, VkDeviceSize min_size) const noexcept
+	{
+		std::uint32_t heap_index = m_memory_properties.memoryTypes[memory_type_index].heapIndex;
+		std::uint32_t chunks_count = std::count_if(m_chunks.begin(), m_chunks.end(), [memory_type_index, pool](const auto& chunk)
+		{
+			return chunk->GetMemoryTypeIndex() == memory_type_index && chunk->GetPool() == pool && !chunk->IsDedicated();
+		});
+		VkDeviceSize chunk_size = m_preferred_chunk_sizes[heap_index] >> (CHUNK_SIZE_GROWTH_STEPS - std::min(chunks_count, CHUNK_SIZE_GROWTH_STEPS));
+		return std::max(chunk_size, min_size);
+	}
+
+	void DeviceAllocator::NewFrame() noexcept
+	{
+		m_last_frame_allocations = m_frame_allocations;
+		m_last_frame_deallocations = m_frame_deallocations;
+		m_frame_allocations.fill(0);
+		m_frame_deallocations.fill(0);
+	}
+
+	MemoryStatistics DeviceAllocator::GetMemoryTypeStatistics(std::uint32_t memory_type_index) const noexcept
+	{
+		MemoryStatistics stats;
+		for(const auto& chunk : m_chunks)
+		{
+			if(chunk->GetMemoryTypeIndex() == static_cast<std::int32_t>(memory_type_index))
+				chunk->AccumulateStatistics(stats);
+		}
+		stats.allocations_per_frame = m_last_frame_allocations[memory_type_index];
+		stats.deallocations_per_frame = m_last_frame_deallocations[memory_type_index];
+		return stats;
+	}
+
+	MemoryStatistics DeviceAllocator::GetHeapStatistics(std::uint32_t heap_index) const noexcept
+	{
+		MemoryStatistics stats;
+		for(std::uint32_t i = 0; i < m_memory_properties.memoryTypeCount; i++)
+		{
+			if(m_memory_properties.memoryTypes[i].heapIndex == heap_index)
+				stats.Merge(GetMemoryTypeStatistics(i));
+		}
+		return stats;
+	}
+
+	MemoryStatistics DeviceAllocator::GetTotalStatistics() const noexcept
+	{
+		MemoryStatistics stats;
+		for(std::uint32_t i = 0; i < m_memory_properties.memoryHeapCount; i++)
+			stats.Merge(GetHeapStatistics(i));
+		return stats;
+	}
+
+	std::string DeviceAllocator::BuildJsonReport() const
+	{
+		auto stats_to_json = [](const MemoryStatistics& stats)
+		{
+			return "\"allocated_bytes\": " + std::to_string(stats.allocated_bytes) +
+				", \"used_bytes\": " + std::to_string(stats.used_bytes) +
+				", \"largest_free_block\": " + std::to_string(stats.largest_free_block) +
+				", \"chunk_count\": " + std::to_string(stats.chunk_count) +
+				", \"block_count\": " + std::to_string(stats.block_count) +
+				", \"free_block_count\": " + std::to_string(stats.free_block_count) +
+				", \"fragmentation\": " + std::to_string(stats.GetFragmentation()) +
+				", \"allocations_per_frame\": " + std::to_string(stats.allocations_per_frame) +
+				", \"deallocations_per_frame\": " + std::to_string(stats.deallocations_per_frame);
+		};
+
+		std::string json = "{\n\t\"heaps\": [";
+		for(std::uint32_t i = 0; i < m_memory_properties.memoryHeapCount; i++)
+		{
+			MemoryBudget budget = GetHeapBudget(i);
+			json += (i == 0 ? "\n" : ",\n");
+			json += "\t\t{ \"index\": " + std::to_string(i) +
+				", \"size\": " + std::to_string(m_memory_properties.memoryHeaps[i].size) +
+				", \"device_local\": " + ((m_memory_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? "true" : "false") +
+				", \"budget\": " + std::to_string(budget.budget) +
+				", \"usage\": " + std::to_string(budget.usage) +
+				", " + stats_to_json(GetHeapStatistics(i)) + " }";
+		}
+		json += "\n\t],\n\t\"memory_types\": [";
+		for(std::uint32_t i = 0; i < m_memory_properties.memoryTypeCount; i++)
+		{
+			json += (i == 0 ? "\n" : ",\n");
+			json += "\t\t{ \"index\": " + std::to_string(i) +
+				", \"heap\": " + std::to_string(m_memory_properties.memoryTypes[i].heapIndex) +
+				", \"property_flags\": " + std::to_string(m_memory_properties.memoryTypes[i].propertyFlags) +
+				", " + stats_to_json(GetMemoryTypeStatistics(i)) + " }";
+		}
+		json += "\n\t],\n\t\"chunks\": [";
+		for(std::size_t i = 0; i < m_chunks.size(); i++)
+		{
+			const MemoryChunk& chunk = *m_chunks[i];
+			json += (i == 0 ? "\n" : ",\n");
+			json += "\t\t{ \"memory_type\": " + std::to_string(chunk.GetMemoryTypeIndex()) +
+				", \"pool\": \"" + (chunk.GetPool() == MemoryPool::Linear ? "linear" : "optimal") + "\"" +
+				", \"dedicated\": " + (chunk.IsDedicated() ? "true" : "false") +
+				", \"size\": " + std::to_string(chunk.GetSize()) +
+				", \"used_bytes\": " + std::to_string(chunk.GetUsedSize()) +
+				", \"blocks\": [";
+			bool first = true;
+			chunk.ForEachBlockRange([&json, &first](VkDeviceSize offset, VkDeviceSize size, bool free)
+			{
+				json += (first ? "\n" : ",\n");
+				json += "\t\t\t{ \"offset\": " + std::to_string(offset) + ", \"size\": " + std::to_string(size) + ", \"free\": " + (free ? "true" : "false") + " }";
+				first = false;
+			});
+			json += "\n\t\t] }";
+		}
+		json += "\n\t]\n}\n";
+		return json;
+	}
+
+	bool DeviceAllocator::DumpJsonReport(const std::filesystem::path& path) const
+	{
+		std::ofstream file(path);
+		if(!file.is_open())
+		{
+			Error("Device Allocator: could not open % to write the memory report", path);
+			return false;
+		}
+		file << BuildJsonReport();
+		return true;
+	}
+
+	std::unique_ptr<MemoryChunk> DeviceAllocator::CreateChunk(VkDeviceSize size, std::int32_t memory_type_index, MemoryPool pool, bool dedicated, VkImage dedicated_image)
+	{
+		return std::make_unique<MemoryChunk>(m_device, m_physical, size, memory_type_index, pool, dedicated, (m_has_dedicated_allocation ? dedicated_image : VK_NULL_HANDLE));
+	}
+
+	void DeviceAllocator::ReleaseChunk(std::size_t index) noexcept
+	{
+		std::uint32_t heap_index = m_memory_properties.memoryTypes[m_chunks[index]->GetMemoryTypeIndex()].heapIndex;
+		m_heap_usage[heap_index] -= m_chunks[index]->GetSize();
+		m_allocations_count--;
+		m_chunks.erase(m_chunks.begin() + index);
 	}
 }
@@ -0,0 +1,109 @@
+#include <Renderer/OneShotCommandPool.h>
+#include <Renderer/RenderCore.h>
+#include <Core/Logs.h>
+
+namespace Scop
+{
+	void OneShotCommandPool::Init()
+	{
+		// Not kvf's pool, its command buffers cannot be reset one by one
+		VkCommandPoolCreateInfo pool_info{};
+		pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		pool_info.queueFamilyIndex = kvfGetDeviceQueueFamily(RenderCore::Get().GetDevice(), KVF_GRAPHICS_QUEUE);
+		kvfCheckVk(RenderCore::Get().vkCreateCommandPool(RenderCore::Get().GetDevice(), &pool_info, nullptr, &m_pool));
+		Message("Vulkan: one shot command pool created");
+	}
+
+	VkCommandBuffer OneShotCommandPool::Get()
+	{
+		if(m_recording)
+			return m_batches[m_current].cmd;
+
+		VkDevice device = RenderCore::Get().GetDevice();
+		std::size_t free_batch = m_batches.size();
+		for(std::size_t i = 0; i < m_batches.size() && free_batch == m_batches.size(); i++)
+		{
+			if(m_batches[i].in_flight && RenderCore::Get().vkGetFenceStatus(device, m_batches[i].fence) == VK_SUCCESS)
+				m_batches[i].in_flight = false;
+			if(!m_batches[i].in_flight)
+				free_batch = i;
+		}
+		if(free_batch == m_batches.size())
+		{
+			Batch& batch = m_batches.emplace_back();
+			VkCommandBufferAllocateInfo alloc_info{};
+			alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			alloc_info.commandPool = m_pool;
+			alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			alloc_info.commandBufferCount = 1;
+			kvfCheckVk(RenderCore::Get().vkAllocateCommandBuffers(device, &alloc_info, &batch.cmd));
+			batch.fence = kvfCreateFence(device);
+		}
+
+		m_current = free_batch;
+		m_batches[m_current].value = m_next_value++;
+		RenderCore::Get().vkResetCommandBuffer(m_batches[m_current].cmd, 0);
+		kvfBeginCommandBuffer(m_batches[m_current].cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		m_recording = true;
+		return m_batches[m_current].cmd;
+	}
+
+	void OneShotCommandPool::Flush()
+	{
+		if(!m_recording)
+			return;
+		// Uploads recorded before may target the same resources
+		RenderCore::Get().GetUploadContext().Flush();
+		Batch& batch = m_batches[m_current];
+		kvfEndCommandBuffer(batch.cmd);
+		RenderCore::Get().vkResetFences(RenderCore::Get().GetDevice(), 1, &batch.fence);
+		VkSubmitInfo submit_info{};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &batch.cmd;
+		kvfCheckVk(RenderCore::Get().vkQueueSubmit(kvfGetDeviceQueue(RenderCore::Get().GetDevice(), KVF_GRAPHICS_QUEUE), 1, &submit_info, batch.fence));
+		batch.in_flight = true;
+		m_recording = false;
+	}
+
+	void OneShotCommandPool::WaitIdle()
+	{
+		Flush();
+		for(Batch& batch : m_batches)
+		{
+			if(!batch.in_flight)
+				continue;
+			kvfWaitForFence(RenderCore::Get().GetDevice(), batch.fence);
+			batch.in_flight = false;
+		}
+	}
+
+	bool OneShotCommandPool::IsComplete(std::uint64_t value)
+	{
+		if(m_recording && m_batches[m_current].value <= value)
+			return false;
+		for(Batch& batch : m_batches)
+		{
+			if(!batch.in_flight || batch.value > value)
+				continue;
+			if(RenderCore::Get().vkGetFenceStatus(RenderCore::Get().GetDevice(), batch.fence) != VK_SUCCESS)
+				return false;
+			batch.in_flight = false;
+		}
+		return true;
+	}
+
+	void OneShotCommandPool::Destroy() noexcept
+	{
+		if(m_pool == VK_NULL_HANDLE)
+			return;
+		WaitIdle();
+		for(Batch& batch : m_batches)
+			kvfDestroyFence(RenderCore::Get().GetDevice(), batch.fence);
+		m_batches.clear();
+		RenderCore::Get().vkDestroyCommandPool(RenderCore::Get().GetDevice(), m_pool, nullptr); // also frees the command buffers
+		m_pool = VK_NULL_HANDLE;
+		Message("Vulkan: one shot command pool destroyed");
+	}
+}
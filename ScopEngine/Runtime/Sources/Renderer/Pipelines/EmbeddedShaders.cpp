@@ -0,0 +1,81 @@
+#include <Renderer/Pipelines/EmbeddedShaders.h>
+
+// Generated by the shaders target next to the .spv files, comma separated words.
+// A missing header is a build error, the engine does not run without its shaders
+
+namespace Scop
+{
+	namespace
+	{
+		constexpr std::uint32_t SPIRV_FORWARD_VERTEX[] = {
+			#include <ForwardVertex.spv.h>
+		};
+		constexpr std::uint32_t SPIRV_FORWARD_DEFAULT_FRAGMENT[] = {
+			#include <ForwardDefaultFragment.spv.h>
+		};
+		constexpr std::uint32_t SPIRV_FORWARD_OPAQUE_FRAGMENT[] = {
+			#include <ForwardOpaqueFragment.spv.h>
+		};
+		constexpr std::uint32_t SPIRV_FORWARD_BASIC_FRAGMENT[] = {
+			#include <ForwardBasicFragment.spv.h>
+		};
+		constexpr std::uint32_t SPIRV_SCREEN_VERTEX[] = {
+			#include <ScreenVertex.spv.h>
+		};
+		constexpr std::uint32_t SPIRV_SCREEN_FRAGMENT[] = {
+			#include <ScreenFragment.spv.h>
+		};
+		constexpr std::uint32_t SPIRV_2D_VERTEX[] = {
+			#include <2DVertex.spv.h>
+		};
+		constexpr std::uint32_t SPIRV_2D_FRAGMENT[] = {
+			#include <2DFragment.spv.h>
+		};
+		constexpr std::uint32_t SPIRV_SKYBOX_VERTEX[] = {
+			#include <SkyboxVertex.spv.h>
+		};
+		constexpr std::uint32_t SPIRV_SKYBOX_FRAGMENT[] = {
+			#include <SkyboxFragment.spv.h>
+		};
+		constexpr std::uint32_t SPIRV_PER_MATERIAL_FORWARD_DEFAULT_FRAGMENT[] = {
+			#include <PerMaterial/ForwardDefaultFragment.spv.h>
+		};
+		constexpr std::uint32_t SPIRV_PER_MATERIAL_FORWARD_OPAQUE_FRAGMENT[] = {
+			#include <PerMaterial/ForwardOpaqueFragment.spv.h>
+		};
+		constexpr std::uint32_t SPIRV_PER_MATERIAL_FORWARD_BASIC_FRAGMENT[] = {
+			#include <PerMaterial/ForwardBasicFragment.spv.h>
+		};
+	}
+
+	std::span<const std::uint32_t> GetEmbeddedShader(std::string_view name) noexcept
+	{
+		if(name == "ForwardVertex")
+			return SPIRV_FORWARD_VERTEX;
+		if(name == "ForwardDefaultFragment")
+			return SPIRV_FORWARD_DEFAULT_FRAGMENT;
+		if(name == "ForwardOpaqueFragment")
+			return SPIRV_FORWARD_OPAQUE_FRAGMENT;
+		if(name == "ForwardBasicFragment")
+			return SPIRV_FORWARD_BASIC_FRAGMENT;
+		if(name == "ScreenVertex")
+			return SPIRV_SCREEN_VERTEX;
+		if(name == "ScreenFragment")
+			return SPIRV_SCREEN_FRAGMENT;
+		if(name == "2DVertex")
+			return SPIRV_2D_VERTEX;
+		if(name == "2DFragment")
+			return SPIRV_2D_FRAGMENT;
+		if(name == "SkyboxVertex")
+			return SPIRV_SKYBOX_VERTEX;
+		if(name == "SkyboxFragment")
+			return SPIRV_SKYBOX_FRAGMENT;
+		if(name == "PerMaterial/ForwardDefaultFragment")
+			return SPIRV_PER_MATERIAL_FORWARD_DEFAULT_FRAGMENT;
+		if(name == "PerMaterial/ForwardOpaqueFragment")
+			return SPIRV_PER_MATERIAL_FORWARD_OPAQUE_FRAGMENT;
+		if(name == "PerMaterial/ForwardBasicFragment")
+			return SPIRV_PER_MATERIAL_FORWARD_BASIC_FRAGMENT;
+		return {};
+	}
+}
@@ -1,7 +1,7 @@
 #include <Renderer/Pipelines/Graphics.h>
+#include <Renderer/Pipelines/PipelineRegistry.h>
 #include <Renderer/RenderCore.h>
 #include <Renderer/Renderer.h>
-#include <Renderer/Vertex.h>
 #include <Core/EventBus.h>
 #include <Core/Logs.h>
 
@@ -13,54 +13,18 @@ namespace Scop
 			FatalError("Vulkan: invalid shaders");
 
 		m_attachments = descriptor.color_attachments;
-		p_vertex_shader = descriptor.vertex_shader;
-		p_fragment_shader = descriptor.fragment_shader;
 		p_renderer = descriptor.renderer;
 		p_depth = descriptor.depth;
 
-		std::vector<VkPushConstantRange> push_constants;
-		std::vector<VkDescriptorSetLayout> set_layouts;
-		push_constants.insert(push_constants.end(), p_vertex_shader->GetPipelineLayout().push_constants.begin(), p_vertex_shader->GetPipelineLayout().push_constants.end());
-		push_constants.insert(push_constants.end(), p_fragment_shader->GetPipelineLayout().push_constants.begin(), p_fragment_shader->GetPipelineLayout().push_constants.end());
-		set_layouts.insert(set_layouts.end(), p_vertex_shader->GetPipelineLayout().set_layouts.begin(), p_vertex_shader->GetPipelineLayout().set_layouts.end());
-		set_layouts.insert(set_layouts.end(), p_fragment_shader->GetPipelineLayout().set_layouts.begin(), p_fragment_shader->GetPipelineLayout().set_layouts.end());
-		m_pipeline_layout = kvfCreatePipelineLayout(RenderCore::Get().GetDevice(), set_layouts.data(), set_layouts.size(), push_constants.data(), push_constants.size());
-
 		TransitionAttachments();
-		CreateFramebuffers(m_attachments, descriptor.clear_color_attachments);
-
-		VkPhysicalDeviceFeatures features{};
-		RenderCore::Get().vkGetPhysicalDeviceFeatures(RenderCore::Get().GetPhysicalDevice(), &features);
-
-		KvfGraphicsPipelineBuilder* builder = kvfCreateGPipelineBuilder();
-		kvfGPipelineBuilderAddShaderStage(builder, p_vertex_shader->GetShaderStage(), p_vertex_shader->GetShaderModule(), "main");
-		kvfGPipelineBuilderAddShaderStage(builder, p_fragment_shader->GetShaderStage(), p_fragment_shader->GetShaderModule(), "main");
-		kvfGPipelineBuilderSetInputTopology(builder, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
-		kvfGPipelineBuilderSetCullMode(builder, descriptor.culling, VK_FRONT_FACE_CLOCKWISE);
-		kvfGPipelineBuilderEnableAlphaBlending(builder);
-		if(p_depth)
-			kvfGPipelineBuilderEnableDepthTest(builder, (descriptor.depth_test_equal ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS), true);
-		else
-			kvfGPipelineBuilderDisableDepthTest(builder);
-		if(features.fillModeNonSolid)
-			kvfGPipelineBuilderSetPolygonMode(builder, descriptor.mode, 1.0f);
-		else
-			kvfGPipelineBuilderSetPolygonMode(builder, VK_POLYGON_MODE_FILL, 1.0f);
-		if(features.sampleRateShading)
-			kvfGPipelineBuilderSetMultisamplingShading(builder, VK_SAMPLE_COUNT_1_BIT, 0.25f);
-		else
-			kvfGPipelineBuilderSetMultisampling(builder, VK_SAMPLE_COUNT_1_BIT);
-
-		if(!descriptor.no_vertex_inputs)
-		{
-			VkVertexInputBindingDescription binding_description = Vertex::GetBindingDescription();
-			auto attributes_description = Vertex::GetAttributeDescriptions();
-			kvfGPipelineBuilderSetVertexInputs(builder, binding_description, attributes_description.data(), attributes_description.size());
-		}
-
-		m_pipeline = kvfCreateGraphicsPipeline(RenderCore::Get().GetDevice(), VK_NULL_HANDLE, m_pipeline_layout, builder, m_renderpass);
-		Message("Vulkan: graphics pipeline created");
-		kvfDestroyGPipelineBuilder(builder);
+		std::vector<VkAttachmentDescription> attachments = BuildAttachmentDescriptions(descriptor.clear_color_attachments);
+		const GraphicPipelineVariant& variant = RenderCore::Get().GetPipelineRegistry().GetGraphicPipeline(descriptor, attachments);
+		m_renderpass = variant.renderpass;
+		m_pipeline_layout = variant.layout;
+		p_variant = &variant;
+		m_clears.clear();
+		m_clears.resize(attachments.size());
+		CreateFramebuffers();
 	}
 
 	bool GraphicPipeline::BindPipeline(VkCommandBuffer command_buffer, std::size_t framebuffer_index, std::array<float, 4> clear) noexcept
@@ -99,6 +63,11 @@ namespace Scop
 		return true;
 	}
 
+	VkPipeline GraphicPipeline::GetPipeline() const
+	{
+		return (p_variant != nullptr ? p_variant->GetReadyPipeline() : VK_NULL_HANDLE);
+	}
+
 	void GraphicPipeline::EndPipeline(VkCommandBuffer command_buffer) noexcept
 	{
 		RenderCore::Get().vkCmdEndRenderPass(command_buffer);
@@ -106,52 +75,47 @@ namespace Scop
 
 	void GraphicPipeline::Destroy() noexcept
 	{
-		RenderCore::Get().WaitDeviceIdle();
-		p_vertex_shader.reset();
-		p_fragment_shader.reset();
-		for(auto& fb : m_framebuffers)
+		// The pipeline itself stays in the registry, only the framebuffers are tied to the attachments
+		if(!m_framebuffers.empty())
 		{
-			kvfDestroyFramebuffer(RenderCore::Get().GetDevice(), fb);
-			Message("Vulkan: framebuffer destroyed");
+			// Frames in flight may still use them
+			RenderCore::Get().GetDeletionQueue().Push([framebuffers = std::move(m_framebuffers)]()
+			{
+				for(VkFramebuffer fb : framebuffers)
+				{
+					kvfDestroyFramebuffer(RenderCore::Get().GetDevice(), fb);
+					Message("Vulkan: framebuffer destroyed");
+				}
+			});
 		}
 		m_framebuffers.clear();
-		kvfDestroyPipelineLayout(RenderCore::Get().GetDevice(), m_pipeline_layout);
+		m_attachments.clear();
 		m_pipeline_layout = VK_NULL_HANDLE;
-		Message("Vulkan: graphics pipeline layout destroyed");
-		kvfDestroyRenderPass(RenderCore::Get().GetDevice(), m_renderpass);
 		m_renderpass = VK_NULL_HANDLE;
-		Message("Vulkan: renderpass destroyed");
-		kvfDestroyPipeline(RenderCore::Get().GetDevice(), m_pipeline);
-		m_pipeline = VK_NULL_HANDLE;
-		Message("Vulkan: graphics pipeline destroyed");
+		p_variant = nullptr;
 	}
 
-	void GraphicPipeline::CreateFramebuffers(const std::vector<NonOwningPtr<Texture>>& render_targets, bool clear_attachments)
+	std::vector<VkAttachmentDescription> GraphicPipeline::BuildAttachmentDescriptions(bool clear_attachments) const
 	{
 		std::vector<VkAttachmentDescription> attachments;
-		std::vector<VkImageView> attachment_views;
 		if(p_renderer)
-		{
 			attachments.push_back(kvfBuildSwapchainAttachmentDescription(p_renderer->GetSwapchain().Get(), clear_attachments));
-			attachment_views.push_back(p_renderer->GetSwapchain().GetSwapchainImages()[0].GetImageView());
-		}
-
-		for(NonOwningPtr<Texture> image : render_targets)
-		{
+		for(NonOwningPtr<Texture> image : m_attachments)
 			attachments.push_back(kvfBuildAttachmentDescription((kvfIsDepthFormat(image->GetFormat()) ? KVF_IMAGE_DEPTH : KVF_IMAGE_COLOR), image->GetFormat(), image->GetLayout(), image->GetLayout(), clear_attachments, VK_SAMPLE_COUNT_1_BIT));
-			attachment_views.push_back(image->GetImageView());
-		}
-
 		if(p_depth)
-		{
 			attachments.push_back(kvfBuildAttachmentDescription((kvfIsDepthFormat(p_depth->GetFormat()) ? KVF_IMAGE_DEPTH : KVF_IMAGE_COLOR), p_depth->GetFormat(), p_depth->GetLayout(), p_depth->GetLayout(), clear_attachments, VK_SAMPLE_COUNT_1_BIT));
-			attachment_views.push_back(p_depth->GetImageView());
-		}
+		return attachments;
+	}
 
-		m_renderpass = kvfCreateRenderPass(RenderCore::Get().GetDevice(), attachments.data(), attachments.size(), GetPipelineBindPoint());
-		m_clears.clear();
-		m_clears.resize(attachments.size());
-		Message("Vulkan: renderpass created");
+	void GraphicPipeline::CreateFramebuffers()
+	{
+		std::vector<VkImageView> attachment_views;
+		if(p_renderer)
+			attachment_views.push_back(p_renderer->GetSwapchain().GetSwapchainImages()[0].GetImageView());
+		for(NonOwningPtr<Texture> image : m_attachments)
+			attachment_views.push_back(image->GetImageView());
+		if(p_depth)
+			attachment_views.push_back(p_depth->GetImageView());
 
 		if(p_renderer)
 		{
@@ -162,7 +126,7 @@ namespace Scop
 				Message("Vulkan: framebuffer created");
 			}
 		}
-		for(NonOwningPtr<Texture> image : render_targets)
+		for(NonOwningPtr<Texture> image : m_attachments)
 		{
 			m_framebuffers.push_back(kvfCreateFramebuffer(RenderCore::Get().GetDevice(), m_renderpass, attachment_views.data(), attachment_views.size(), { .width = image->GetWidth(), .height = image->GetHeight() }));
 			Message("Vulkan: framebuffer created");
@@ -0,0 +1,108 @@
+#include <Renderer/Pipelines/PipelineCache.h>
+#include <Renderer/RenderCore.h>
+#include <Core/Logs.h>
+
+#include <vector>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace Scop
+{
+	void PipelineCache::Init(const std::filesystem::path& directory)
+	{
+		VkPhysicalDeviceProperties properties;
+		RenderCore::Get().vkGetPhysicalDeviceProperties(RenderCore::Get().GetPhysicalDevice(), &properties);
+
+		std::ostringstream name;
+		name << "pipelines_";
+		for(std::uint8_t byte : properties.pipelineCacheUUID)
+			name << std::hex << std::setw(2) << std::setfill('0') << static_cast<std::uint32_t>(byte);
+		name << '_' << std::dec << properties.driverVersion << ".bin";
+		m_path = directory / name.str();
+
+		std::vector<char> data;
+		std::ifstream file(m_path, std::ios::binary | std::ios::ate);
+		if(file.is_open())
+		{
+			data.resize(file.tellg());
+			file.seekg(0, std::ios::beg);
+			file.read(data.data(), data.size());
+			if(!file)
+				data.clear();
+		}
+
+		// The driver ignores data it does not recognize but some are less forgiving than others, the header is checked first
+		if(!data.empty())
+		{
+			VkPipelineCacheHeaderVersionOne header{};
+			if(data.size() < sizeof(header))
+				data.clear();
+			else
+			{
+				std::memcpy(&header, data.data(), sizeof(header));
+				if(header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || header.vendorID != properties.vendorID || header.deviceID != properties.deviceID || std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+				{
+					Warning("Vulkan: pipeline cache file % does not match the device, it is ignored", m_path);
+					data.clear();
+				}
+			}
+		}
+
+		VkPipelineCacheCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		info.initialDataSize = data.size();
+		info.pInitialData = data.data();
+		if(RenderCore::Get().vkCreatePipelineCache(RenderCore::Get().GetDevice(), &info, nullptr, &m_cache) != VK_SUCCESS && !data.empty())
+		{
+			info.initialDataSize = 0;
+			info.pInitialData = nullptr;
+			data.clear();
+			kvfCheckVk(RenderCore::Get().vkCreatePipelineCache(RenderCore::Get().GetDevice(), &info, nullptr, &m_cache));
+		}
+		m_is_warm = !data.empty();
+		Message("Vulkan: pipeline cache created (%)", (m_is_warm ? "warm, loaded from disk" : "cold"));
+	}
+
+	void PipelineCache::Save() noexcept
+	{
+		if(m_cache == VK_NULL_HANDLE)
+			return;
+		std::size_t size = 0;
+		if(RenderCore::Get().vkGetPipelineCacheData(RenderCore::Get().GetDevice(), m_cache, &size, nullptr) != VK_SUCCESS || size == 0)
+			return;
+		std::vector<char> data(size);
+		if(RenderCore::Get().vkGetPipelineCacheData(RenderCore::Get().GetDevice(), m_cache, &size, data.data()) != VK_SUCCESS)
+			return;
+
+		// Written aside then renamed so an interrupted write never leaves a truncated cache behind
+		std::error_code error;
+		std::filesystem::create_directories(m_path.parent_path(), error);
+		std::filesystem::path tmp_path = m_path;
+		tmp_path += ".tmp";
+		{
+			std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+			if(!file.is_open() || !file.write(data.data(), size))
+			{
+				Warning("Vulkan: could not write pipeline cache to %", m_path);
+				return;
+			}
+		}
+		std::filesystem::rename(tmp_path, m_path, error);
+		if(error)
+			Warning("Vulkan: could not write pipeline cache to %", m_path);
+		else
+			Message("Vulkan: pipeline cache saved (% bytes)", size);
+	}
+
+	void PipelineCache::Destroy() noexcept
+	{
+		if(m_cache == VK_NULL_HANDLE)
+			return;
+		Save();
+		RenderCore::Get().vkDestroyPipelineCache(RenderCore::Get().GetDevice(), m_cache, nullptr);
+		m_cache = VK_NULL_HANDLE;
+		Message("Vulkan: pipeline cache destroyed");
+	}
+}
@@ -0,0 +1,216 @@
+#include <Renderer/Pipelines/PipelineRegistry.h>
+#include <Renderer/RenderCore.h>
+#include <Renderer/Vertex.h>
+#include <Core/Logs.h>
+
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <functional>
+
+namespace Scop
+{
+	namespace
+	{
+		inline void HashCombine(std::size_t& hash, std::size_t value) noexcept
+		{
+			hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+		}
+
+		inline bool AttachmentEquals(const VkAttachmentDescription& lhs, const VkAttachmentDescription& rhs) noexcept
+		{
+			return  lhs.flags == rhs.flags &&
+					lhs.format == rhs.format &&
+					lhs.samples == rhs.samples &&
+					lhs.loadOp == rhs.loadOp &&
+					lhs.storeOp == rhs.storeOp &&
+					lhs.stencilLoadOp == rhs.stencilLoadOp &&
+					lhs.stencilStoreOp == rhs.stencilStoreOp &&
+					lhs.initialLayout == rhs.initialLayout &&
+					lhs.finalLayout == rhs.finalLayout;
+		}
+	}
+
+	bool PipelineRegistry::GraphicPipelineKey::operator==(const GraphicPipelineKey& other) const noexcept
+	{
+		return  vertex_shader == other.vertex_shader &&
+				fragment_shader == other.fragment_shader &&
+				culling == other.culling &&
+				mode == other.mode &&
+				depth == other.depth &&
+				depth_test_equal == other.depth_test_equal &&
+				depth_write == other.depth_write &&
+				blending == other.blending &&
+				no_vertex_inputs == other.no_vertex_inputs &&
+				std::equal(attachments.begin(), attachments.end(), other.attachments.begin(), other.attachments.end(), AttachmentEquals);
+	}
+
+	std::size_t PipelineRegistry::GraphicPipelineKeyHash::operator()(const GraphicPipelineKey& key) const noexcept
+	{
+		std::size_t hash = std::hash<const Shader*>{}(key.vertex_shader);
+		HashCombine(hash, std::hash<const Shader*>{}(key.fragment_shader));
+		HashCombine(hash, key.culling);
+		HashCombine(hash, key.mode);
+		HashCombine(hash, (key.depth << 4) | (key.depth_test_equal << 3) | (key.depth_write << 2) | (key.blending << 1) | key.no_vertex_inputs);
+		for(const VkAttachmentDescription& attachment : key.attachments)
+		{
+			HashCombine(hash, attachment.format);
+			HashCombine(hash, attachment.loadOp);
+			HashCombine(hash, attachment.initialLayout);
+			HashCombine(hash, attachment.finalLayout);
+		}
+		return hash;
+	}
+
+	PipelineRegistry::PipelineRegistry()
+	{
+		// Pipeline creation is thread safe by the specification, workers are only worth it with a spare core
+		m_compile_in_background = std::thread::hardware_concurrency() > 1;
+	}
+
+	const GraphicPipelineVariant& PipelineRegistry::GetGraphicPipeline(const GraphicPipelineDescriptor& descriptor, const std::vector<VkAttachmentDescription>& attachments)
+	{
+		if(!descriptor.vertex_shader || !descriptor.fragment_shader)
+			FatalError("Vulkan: invalid shaders");
+
+		GraphicPipelineKey key{
+			descriptor.vertex_shader.get(),
+			descriptor.fragment_shader.get(),
+			attachments,
+			descriptor.culling,
+			descriptor.mode,
+			static_cast<bool>(descriptor.depth),
+			descriptor.depth_test_equal,
+			descriptor.depth_write,
+			descriptor.blending,
+			descriptor.no_vertex_inputs
+		};
+		auto it = m_graphic_pipelines.find(key);
+		if(it != m_graphic_pipelines.end())
+			return it->second.variant;
+
+		const GraphicPipelineVariant* fallback = (m_compile_in_background ? FindFallback(key) : nullptr);
+		GraphicPipelineEntry& entry = m_graphic_pipelines.emplace(std::move(key), GraphicPipelineEntry{}).first->second;
+		entry.vertex_shader = descriptor.vertex_shader;
+		entry.fragment_shader = descriptor.fragment_shader;
+		entry.variant.fallback = fallback;
+		CreateGraphicPipeline(entry, descriptor, attachments);
+		return entry.variant;
+	}
+
+	void PipelineRegistry::Update()
+	{
+		for(auto& [key, entry] : m_graphic_pipelines)
+		{
+			if(!entry.compilation.valid() || entry.compilation.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				continue;
+			auto [pipeline, milliseconds] = entry.compilation.get();
+			entry.variant.pipeline = pipeline;
+			entry.variant.fallback = nullptr;
+			RenderCore::Get().GetPipelineCache().RecordPipelineCreation(milliseconds);
+			Message("Vulkan: graphics pipeline compiled in the background in % ms", milliseconds);
+		}
+	}
+
+	const GraphicPipelineVariant* PipelineRegistry::FindFallback(const GraphicPipelineKey& key) const noexcept
+	{
+		for(const auto& [other, entry] : m_graphic_pipelines)
+		{
+			if(entry.variant.pipeline == VK_NULL_HANDLE)
+				continue;
+			// Same shaders, render pass, blending and depth states, only the culling and polygon mode may differ.
+			// Drawing translucent geometry with an opaque variant would hide what is behind it
+			if(other.vertex_shader == key.vertex_shader && other.fragment_shader == key.fragment_shader && other.depth == key.depth && other.no_vertex_inputs == key.no_vertex_inputs &&
+				other.depth_test_equal == key.depth_test_equal && other.depth_write == key.depth_write && other.blending == key.blending &&
+				std::equal(other.attachments.begin(), other.attachments.end(), key.attachments.begin(), key.attachments.end(), AttachmentEquals))
+				return &entry.variant;
+		}
+		return nullptr;
+	}
+
+	void PipelineRegistry::CreateGraphicPipeline(GraphicPipelineEntry& entry, const GraphicPipelineDescriptor& descriptor, const std::vector<VkAttachmentDescription>& attachments)
+	{
+		GraphicPipelineVariant& variant = entry.variant;
+		const Shader& vertex_shader = *descriptor.vertex_shader;
+		const Shader& fragment_shader = *descriptor.fragment_shader;
+
+		std::vector<VkPushConstantRange> push_constants;
+		std::vector<VkDescriptorSetLayout> set_layouts;
+		push_constants.insert(push_constants.end(), vertex_shader.GetPipelineLayout().push_constants.begin(), vertex_shader.GetPipelineLayout().push_constants.end());
+		push_constants.insert(push_constants.end(), fragment_shader.GetPipelineLayout().push_constants.begin(), fragment_shader.GetPipelineLayout().push_constants.end());
+		set_layouts.insert(set_layouts.end(), vertex_shader.GetPipelineLayout().set_layouts.begin(), vertex_shader.GetPipelineLayout().set_layouts.end());
+		set_layouts.insert(set_layouts.end(), fragment_shader.GetPipelineLayout().set_layouts.begin(), fragment_shader.GetPipelineLayout().set_layouts.end());
+		variant.layout = kvfCreatePipelineLayout(RenderCore::Get().GetDevice(), set_layouts.data(), set_layouts.size(), push_constants.data(), push_constants.size());
+
+		variant.renderpass = kvfCreateRenderPass(RenderCore::Get().GetDevice(), const_cast<VkAttachmentDescription*>(attachments.data()), attachments.size(), VK_PIPELINE_BIND_POINT_GRAPHICS);
+		Message("Vulkan: renderpass created");
+
+		VkPhysicalDeviceFeatures features{};
+		RenderCore::Get().vkGetPhysicalDeviceFeatures(RenderCore::Get().GetPhysicalDevice(), &features);
+
+		KvfGraphicsPipelineBuilder* builder = kvfCreateGPipelineBuilder();
+		kvfGPipelineBuilderAddShaderStage(builder, vertex_shader.GetShaderStage(), vertex_shader.GetShaderModule(), "main");
+		kvfGPipelineBuilderAddShaderStage(builder, fragment_shader.GetShaderStage(), fragment_shader.GetShaderModule(), "main");
+		kvfGPipelineBuilderSetInputTopology(builder, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+		kvfGPipelineBuilderSetCullMode(builder, descriptor.culling, VK_FRONT_FACE_CLOCKWISE);
+		if(descriptor.blending)
+			kvfGPipelineBuilderEnableAlphaBlending(builder);
+		else
+			kvfGPipelineBuilderDisableBlending(builder);
+		if(descriptor.depth)
+			kvfGPipelineBuilderEnableDepthTest(builder, (descriptor.depth_test_equal ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS), descriptor.depth_write);
+		else
+			kvfGPipelineBuilderDisableDepthTest(builder);
+		if(features.fillModeNonSolid)
+			kvfGPipelineBuilderSetPolygonMode(builder, descriptor.mode, 1.0f);
+		else
+			kvfGPipelineBuilderSetPolygonMode(builder, VK_POLYGON_MODE_FILL, 1.0f);
+		if(features.sampleRateShading)
+			kvfGPipelineBuilderSetMultisamplingShading(builder, VK_SAMPLE_COUNT_1_BIT, 0.25f);
+		else
+			kvfGPipelineBuilderSetMultisampling(builder, VK_SAMPLE_COUNT_1_BIT);
+
+		if(!descriptor.no_vertex_inputs)
+		{
+			VkVertexInputBindingDescription binding_description = Vertex::GetBindingDescription();
+			auto attributes_description = Vertex::GetAttributeDescriptions();
+			kvfGPipelineBuilderSetVertexInputs(builder, binding_description, attributes_description.data(), attributes_description.size());
+		}
+
+		// The builder owns copies of all its states and the entry keeps the shader modules alive, it can be handed to a worker as is
+		auto compile = [device = RenderCore::Get().GetDevice(), cache = RenderCore::Get().GetPipelineCache().Get(), layout = variant.layout, renderpass = variant.renderpass, builder]() -> std::pair<VkPipeline, std::uint64_t>
+		{
+			auto creation_begin = std::chrono::steady_clock::now();
+			VkPipeline pipeline = kvfCreateGraphicsPipeline(device, cache, layout, builder, renderpass);
+			kvfDestroyGPipelineBuilder(builder);
+			return { pipeline, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - creation_begin).count() };
+		};
+
+		if(variant.fallback != nullptr)
+		{
+			entry.compilation = std::async(std::launch::async, std::move(compile));
+			Message("Vulkan: graphics pipeline compiling in the background (% variants)", m_graphic_pipelines.size());
+			return;
+		}
+		auto [pipeline, milliseconds] = compile();
+		variant.pipeline = pipeline;
+		RenderCore::Get().GetPipelineCache().RecordPipelineCreation(milliseconds);
+		Message("Vulkan: graphics pipeline created (% variants)", m_graphic_pipelines.size());
+	}
+
+	void PipelineRegistry::Destroy() noexcept
+	{
+		for(auto& [key, entry] : m_graphic_pipelines)
+		{
+			if(entry.compilation.valid())
+				entry.variant.pipeline = entry.compilation.get().first;
+			kvfDestroyPipeline(RenderCore::Get().GetDevice(), entry.variant.pipeline);
+			Message("Vulkan: graphics pipeline destroyed");
+			kvfDestroyPipelineLayout(RenderCore::Get().GetDevice(), entry.variant.layout);
+			Message("Vulkan: graphics pipeline layout destroyed");
+			kvfDestroyRenderPass(RenderCore::Get().GetDevice(), entry.variant.renderpass);
+			Message("Vulkan: renderpass destroyed");
+		}
+		m_graphic_pipelines.clear();
+	}
+}
@@ -1,6 +1,9 @@
 #include <Renderer/Pipelines/Shader.h>
+#include <Renderer/Pipelines/EmbeddedShaders.h>
 #include <Renderer/RenderCore.h>
+#include <Renderer/Descriptor.h>
 #include <Core/Logs.h>
+#include <Core/Engine.h>
 #include <fstream>
 
 namespace Scop
@@ -26,6 +29,7 @@ namespace Scop
 		for(auto& [n, set] : layout.set_layouts)
 		{
 			std::vector<VkDescriptorSetLayoutBinding> bindings(set.binds.size());
+			std::vector<VkDescriptorBindingFlagsEXT> binding_flags(set.binds.size(), 0);
 			for(std::size_t i = 0; i < set.binds.size(); i++)
 			{
 				bindings[i].binding = set.binds[i].first;
@@ -33,8 +37,36 @@ namespace Scop
 				bindings[i].descriptorType = set.binds[i].second;
 				bindings[i].pImmutableSamplers = nullptr;
 				bindings[i].stageFlags = m_stage;
+				for(auto [binding, count] : set.arrays)
+				{
+					if(binding != set.binds[i].first)
+						continue;
+					bindings[i].descriptorCount = count;
+					binding_flags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT;
+				}
 			}
-			m_set_layouts.emplace_back(kvfCreateDescriptorSetLayout(RenderCore::Get().GetDevice(), bindings.data(), bindings.size()));
+			if(!set.arrays.empty() && RenderCore::Get().HasDescriptorIndexing())
+			{
+				// Sets of this layout must come from update after bind pools
+				VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flags_info{};
+				flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+				flags_info.bindingCount = binding_flags.size();
+				flags_info.pBindingFlags = binding_flags.data();
+
+				VkDescriptorSetLayoutCreateInfo layout_info{};
+				layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+				layout_info.pNext = &flags_info;
+				layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+				layout_info.bindingCount = bindings.size();
+				layout_info.pBindings = bindings.data();
+
+				VkDescriptorSetLayout vklayout = VK_NULL_HANDLE;
+				if(RenderCore::Get().vkCreateDescriptorSetLayout(RenderCore::Get().GetDevice(), &layout_info, nullptr, &vklayout) != VK_SUCCESS)
+					FatalError("Vulkan: failed to create a descriptor set layout");
+				m_set_layouts.emplace_back(vklayout);
+			}
+			else
+				m_set_layouts.emplace_back(kvfCreateDescriptorSetLayout(RenderCore::Get().GetDevice(), bindings.data(), bindings.size()));
 			Message("Vulkan: descriptor set layout created");
 			m_pipeline_layout_part.set_layouts.push_back(m_set_layouts.back());
 		}
@@ -60,6 +92,7 @@ namespace Scop
 		Message("Vulkan: shader module destroyed");
 		for(auto& layout : m_set_layouts)
 		{
+			RenderCore::Get().GetDescriptorAllocator().ForgetLayout(layout);
 			kvfDestroyDescriptorSetLayout(RenderCore::Get().GetDevice(), layout);
 			Message("Vulkan: descriptor set layout destroyed");
 		}
@@ -67,18 +100,33 @@ namespace Scop
 
 	std::shared_ptr<Shader> LoadShaderFromFile(const std::filesystem::path& filepath, ShaderType type, ShaderLayout layout)
 	{
-		std::ifstream stream(filepath, std::ios::binary);
+		std::ifstream stream(filepath, std::ios::binary | std::ios::ate);
 		if(!stream.is_open())
 			FatalError("Renderer : unable to open a spirv shader file, %", filepath);
-		std::vector<std::uint32_t> data;
+		std::vector<std::uint32_t> data(static_cast<std::size_t>(stream.tellg()) / sizeof(std::uint32_t));
 		stream.seekg(0);
-		std::uint32_t part = 0;
-		while(stream.read(reinterpret_cast<char*>(&part), sizeof(part)))
-			data.push_back(part);
+		stream.read(reinterpret_cast<char*>(data.data()), data.size() * sizeof(std::uint32_t));
 		stream.close();
 
 		std::shared_ptr<Shader> shader = std::make_shared<Shader>(data, type, layout);
 		Message("Vulkan: shader loaded %", filepath);
 		return shader;
 	}
+
+	std::shared_ptr<Shader> LoadShader(std::string_view name, ShaderType type, ShaderLayout layout)
+	{
+		#ifdef DEBUG
+			// Shaders recompiled on disk are picked up without relinking the engine
+			std::filesystem::path filepath = ScopEngine::Get().GetAssetsPath() / "Shaders/Build" / (std::string{ name } + ".spv");
+			if(std::filesystem::exists(filepath))
+				return LoadShaderFromFile(filepath, type, std::move(layout));
+		#endif
+		std::span<const std::uint32_t> bytecode = GetEmbeddedShader(name);
+		if(bytecode.empty())
+			FatalError("Renderer : unknown engine shader, %", name);
+
+		std::shared_ptr<Shader> shader = std::make_shared<Shader>(std::vector<std::uint32_t>(bytecode.begin(), bytecode.end()), type, std::move(layout));
+		Message("Vulkan: shader loaded % (embedded)", name);
+		return shader;
+	}
 }
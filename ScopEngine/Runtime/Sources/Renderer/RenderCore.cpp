@@ -3,10 +3,17 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
 
 #include <Core/Engine.h>
 #include <Platform/Window.h>
 #include <Renderer/RenderCore.h>
+#include <Renderer/GeometryHeap.h>
+#include <Renderer/FrameArena.h>
+#include <Renderer/Pipelines/PipelineRegistry.h>
+#include <Renderer/Descriptor.h>
+#include <Renderer/BindlessTable.h>
 #include <Renderer/Pipelines/Shader.h>
 #include <Renderer/Vulkan/VulkanLoader.h>
 #include <Maths/Mat4.h>
@@ -51,6 +58,45 @@ namespace Scop
 		return std::nullopt;
 	}
 
+	// Only counts host visible device local memory that can hold resources, not the small BAR window of discrete GPUs
+	static bool FindDirectWriteDeviceMemory(VkPhysicalDevice physical)
+	{
+		VkPhysicalDeviceMemoryProperties mem_properties;
+		RenderCore::Get().vkGetPhysicalDeviceMemoryProperties(physical, &mem_properties);
+		VkDeviceSize largest_device_heap = 0;
+		for(std::uint32_t i = 0; i < mem_properties.memoryHeapCount; i++)
+		{
+			if(mem_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+				largest_device_heap = std::max(largest_device_heap, mem_properties.memoryHeaps[i].size);
+		}
+		for(std::uint32_t i = 0; i < mem_properties.memoryTypeCount; i++)
+		{
+			if((mem_properties.memoryTypes[i].propertyFlags & DIRECT_WRITE_MEMORY_PROPERTIES) != DIRECT_WRITE_MEMORY_PROPERTIES)
+				continue;
+			if(mem_properties.memoryHeaps[mem_properties.memoryTypes[i].heapIndex].size >= largest_device_heap)
+				return true;
+		}
+		return false;
+	}
+
+	static bool IsInstanceExtensionSupported(const char* name)
+	{
+		std::uint32_t count = 0;
+		RenderCore::Get().vkEnumerateInstanceExtensionProperties(nullptr, &count, nullptr);
+		std::vector<VkExtensionProperties> extensions(count);
+		RenderCore::Get().vkEnumerateInstanceExtensionProperties(nullptr, &count, extensions.data());
+		return std::any_of(extensions.begin(), extensions.end(), [name](const VkExtensionProperties& ext) { return std::strcmp(ext.extensionName, name) == 0; });
+	}
+
+	static bool IsDeviceExtensionSupported(VkPhysicalDevice physical, const char* name)
+	{
+		std::uint32_t count = 0;
+		RenderCore::Get().vkEnumerateDeviceExtensionProperties(physical, nullptr, &count, nullptr);
+		std::vector<VkExtensionProperties> extensions(count);
+		RenderCore::Get().vkEnumerateDeviceExtensionProperties(physical, nullptr, &count, extensions.data());
+		return std::any_of(extensions.begin(), extensions.end(), [name](const VkExtensionProperties& ext) { return std::strcmp(ext.extensionName, name) == 0; });
+	}
+
 	void ErrorCallback(const char* message) noexcept
 	{
 		Logs::Report(LogType::FatalError, 0, "", "", message);
@@ -92,6 +138,10 @@ namespace Scop
 
 		//kvfAddLayer("VK_LAYER_MESA_overlay");
 
+		bool has_properties2 = IsInstanceExtensionSupported(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+		if(has_properties2)
+			instance_extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+
 		m_instance = kvfCreateInstance(instance_extensions.data(), instance_extensions.size());
 		Message("Vulkan: instance created");
 
@@ -107,10 +157,64 @@ namespace Scop
 		vkGetPhysicalDeviceProperties(m_physical_device, &props);
 		Message("Vulkan: physical device picked '%'", props.deviceName);
 
-		const char* device_extensions[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
-		VkPhysicalDeviceFeatures features{};
-		vkGetPhysicalDeviceFeatures(m_physical_device, &features);
-		m_device = kvfCreateDevice(m_physical_device, device_extensions, sizeof(device_extensions) / sizeof(device_extensions[0]), &features);
+		std::vector<const char*> device_extensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+		bool has_memory_budget = has_properties2 && IsDeviceExtensionSupported(m_physical_device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		if(has_memory_budget)
+			device_extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		bool has_dedicated_allocation = IsDeviceExtensionSupported(m_physical_device, VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME) && IsDeviceExtensionSupported(m_physical_device, VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME);
+		if(has_dedicated_allocation)
+		{
+			device_extensions.push_back(VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME);
+			device_extensions.push_back(VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME);
+		}
+		vkGetPhysicalDeviceFeatures(m_physical_device, &m_features);
+
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexing_features{};
+		indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+		if(has_properties2 && vkGetPhysicalDeviceFeatures2KHR != nullptr && IsDeviceExtensionSupported(m_physical_device, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) && IsDeviceExtensionSupported(m_physical_device, VK_KHR_MAINTENANCE3_EXTENSION_NAME))
+		{
+			VkPhysicalDeviceFeatures2 features2{};
+			features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			features2.pNext = &indexing_features;
+			vkGetPhysicalDeviceFeatures2KHR(m_physical_device, &features2);
+			m_has_descriptor_indexing = indexing_features.descriptorBindingPartiallyBound && indexing_features.descriptorBindingSampledImageUpdateAfterBind;
+		}
+		if(m_has_descriptor_indexing)
+		{
+			// Update after bind descriptors have their own limits, that may be lower than the regular ones
+			VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexing_properties{};
+			indexing_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+			VkPhysicalDeviceProperties2 properties2{};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			properties2.pNext = &indexing_properties;
+			if(vkGetPhysicalDeviceProperties2KHR != nullptr)
+				vkGetPhysicalDeviceProperties2KHR(m_physical_device, &properties2);
+			m_has_descriptor_indexing = std::min({
+				indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+				indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+				indexing_properties.maxDescriptorSetUpdateAfterBindSamplers,
+				indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages
+			}) >= MAX_BINDLESS_TEXTURES;
+		}
+		m_has_bindless_textures = m_has_descriptor_indexing || std::min({
+			props.limits.maxPerStageDescriptorSamplers,
+			props.limits.maxPerStageDescriptorSampledImages,
+			props.limits.maxDescriptorSetSamplers,
+			props.limits.maxDescriptorSetSampledImages
+		}) >= MAX_BINDLESS_TEXTURES;
+		if(!m_has_bindless_textures)
+			Warning("Vulkan: the device cannot sample % textures in a shader stage, materials will use their own descriptor sets", MAX_BINDLESS_TEXTURES);
+		// Only what the bindless table needs is enabled
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT enabled_indexing_features{};
+		enabled_indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+		if(m_has_descriptor_indexing)
+		{
+			device_extensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+			device_extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+			enabled_indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+			enabled_indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		}
+		m_device = kvfCreateDeviceWithNext(m_physical_device, device_extensions.data(), device_extensions.size(), &m_features, m_has_descriptor_indexing ? &enabled_indexing_features : nullptr);
 		Message("Vulkan: logical device created");
 
 		loader->LoadDevice(m_device);
@@ -118,42 +222,54 @@ namespace Scop
 
 		vkDestroySurfaceKHR(m_instance, surface, nullptr);
 
-		m_allocator.AttachToDevice(m_device, m_physical_device);
+		m_allocator.AttachToDevice(m_device, m_physical_device, has_memory_budget, has_dedicated_allocation);
+		m_has_direct_write_memory = FindDirectWriteDeviceMemory(m_physical_device);
+		if(m_has_direct_write_memory)
+			Message("Vulkan: device local memory is host visible, device local buffers will be written without staging");
+		p_frame_arena = std::make_unique<FrameArena>();
+		p_frame_arena->Init();
+		m_upload_context.Init();
+		m_one_shot_commands.Init();
+		m_pipeline_cache.Init(ScopEngine::Get().GetAssetsPath() / "Cache");
+		p_pipeline_registry = std::make_unique<PipelineRegistry>();
+		p_geometry_heap = std::make_unique<GeometryHeap>();
+		p_uniform_ring = std::make_unique<UniformRingBuffer>();
+		p_uniform_ring->Init();
+		p_descriptor_allocator = std::make_unique<DescriptorAllocator>();
 
 		ShaderLayout vertex_shader_layout(
 			{
 				{ 0,
 					ShaderSetLayout({ 
-						{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER }
-					})
-				}
-			}, { ShaderPushConstantLayout({ 0, sizeof(Mat4f) * 2 }) }
-		);
-		m_internal_shaders[DEFAULT_VERTEX_SHADER_ID] = LoadShaderFromFile(ScopEngine::Get().GetAssetsPath() / "Shaders/Build/ForwardVertex.spv", ShaderType::Vertex, std::move(vertex_shader_layout));
-
-		ShaderLayout default_fragment_shader_layout(
-			{
-				{ 1,
-					ShaderSetLayout({ 
-						{ 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER },
-						{ 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER }
+						{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC },
+						{ 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER }
 					})
 				}
 			}, {}
 		);
-		m_internal_shaders[DEFAULT_FRAGMENT_SHADER_ID] = LoadShaderFromFile(ScopEngine::Get().GetAssetsPath() / "Shaders/Build/ForwardDefaultFragment.spv", ShaderType::Fragment, std::move(default_fragment_shader_layout));
+		m_internal_shaders[DEFAULT_VERTEX_SHADER_ID] = LoadShader("ForwardVertex", ShaderType::Vertex, std::move(vertex_shader_layout));
 
-		ShaderLayout basic_fragment_shader_layout(
+		// All forward fragment shaders read the bindless table and a material index. Devices that cannot sample the
+		// whole table use the variants built with a single texture, bound with a set per material
+		std::uint32_t texture_count = (m_has_bindless_textures ? MAX_BINDLESS_TEXTURES : 1);
+		std::string variant = (m_has_bindless_textures ? "" : "PerMaterial/");
+		ShaderLayout forward_fragment_shader_layout(
 			{
 				{ 1,
 					ShaderSetLayout({ 
 						{ 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER },
-						{ 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER }
-					})
+						{ BINDLESS_MATERIALS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER }
+					}, { { 0, texture_count } })
 				}
-			}, {}
+			}, { ShaderPushConstantLayout({ 0, sizeof(std::uint32_t) }) } // material index
 		);
-		m_internal_shaders[BASIC_FRAGMENT_SHADER_ID] = LoadShaderFromFile(ScopEngine::Get().GetAssetsPath() / "Shaders/Build/ForwardBasicFragment.spv", ShaderType::Fragment, std::move(basic_fragment_shader_layout));
+		m_internal_shaders[DEFAULT_FRAGMENT_SHADER_ID] = LoadShader(variant + "ForwardDefaultFragment", ShaderType::Fragment, forward_fragment_shader_layout);
+		m_internal_shaders[BASIC_FRAGMENT_SHADER_ID] = LoadShader(variant + "ForwardBasicFragment", ShaderType::Fragment, forward_fragment_shader_layout);
+		m_internal_shaders[OPAQUE_FRAGMENT_SHADER_ID] = LoadShader(variant + "ForwardOpaqueFragment", ShaderType::Fragment, std::move(forward_fragment_shader_layout));
+
+		// Sets of one forward fragment shader layout are compatible with the others
+		p_bindless_table = std::make_unique<BindlessTable>();
+		p_bindless_table->Init(*m_internal_shaders[DEFAULT_FRAGMENT_SHADER_ID]);
 	}
 
 	#undef SCOP_LOAD_FUNCTION
@@ -258,6 +374,22 @@ namespace Scop
 		if(s_instance == nullptr)
 			return;
 		WaitDeviceIdle();
+		p_uniform_ring->Destroy();
+		p_uniform_ring.reset();
+		p_geometry_heap->Destroy();
+		// Kept alive until the end as images, descriptor sets and shaders may still release into them
+		p_bindless_table->Destroy();
+		// Pending deleters may still return ranges and sets to the geometry heap and the descriptor allocator
+		m_deletion_queue.Flush();
+		p_geometry_heap.reset();
+		p_descriptor_allocator->Destroy();
+		p_pipeline_registry->Destroy();
+		p_pipeline_registry.reset();
+		m_pipeline_cache.Destroy();
+		m_one_shot_commands.Destroy();
+		m_upload_context.Destroy();
+		p_frame_arena->Destroy();
+		p_frame_arena.reset();
 		m_allocator.DetachFromDevice();
 		kvfDestroyDevice(m_device);
 		Message("Vulkan: logical device destroyed");
@@ -11,6 +11,7 @@ namespace Scop
 	struct SpriteData
 	{
 		Vec4f color;
+		Vec4f uv_rect;
 		Vec2f position;
 	};
 
@@ -25,12 +26,12 @@ namespace Scop
 			{
 				{ 0,
 					ShaderSetLayout({ 
-						{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER }
+						{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC }
 					})
 				}
 			}, { ShaderPushConstantLayout({ 0, sizeof(SpriteData) }) }
 		);
-		p_vertex_shader = LoadShaderFromFile(ScopEngine::Get().GetAssetsPath() / "Shaders/Build/2DVertex.spv", ShaderType::Vertex, std::move(vertex_shader_layout));
+		p_vertex_shader = LoadShader("2DVertex", ShaderType::Vertex, std::move(vertex_shader_layout));
 		ShaderLayout fragment_shader_layout(
 			{
 				{ 1,
@@ -40,7 +41,7 @@ namespace Scop
 				}
 			}, {}
 		);
-		p_fragment_shader = LoadShaderFromFile(ScopEngine::Get().GetAssetsPath() / "Shaders/Build/2DFragment.spv", ShaderType::Fragment, std::move(fragment_shader_layout));
+		p_fragment_shader = LoadShader("2DFragment", ShaderType::Fragment, std::move(fragment_shader_layout));
 
 		std::function<void(const EventBase&)> functor = [this](const EventBase& event)
 		{
@@ -52,11 +53,9 @@ namespace Scop
 		p_viewer_data_set = std::make_shared<DescriptorSet>(p_vertex_shader->GetShaderLayout().set_layouts[0].second, p_vertex_shader->GetPipelineLayout().set_layouts[0], ShaderType::Vertex);
 		p_texture_set = std::make_shared<DescriptorSet>(p_fragment_shader->GetShaderLayout().set_layouts[0].second, p_fragment_shader->GetPipelineLayout().set_layouts[0], ShaderType::Fragment);
 
-		p_viewer_data_buffer = std::make_shared<UniformBuffer>();
-		p_viewer_data_buffer->Init(sizeof(ViewerData2D));
 		for(std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 		{
-			p_viewer_data_set->SetUniformBuffer(i, 0, p_viewer_data_buffer->Get(i));
+			p_viewer_data_set->SetUniformBuffer(i, 0, RenderCore::Get().GetUniformRing().GetBuffer(), sizeof(ViewerData2D));
 			p_viewer_data_set->Update(i);
 		}
 	}
@@ -76,24 +75,30 @@ namespace Scop
 
 		std::uint32_t frame_index = renderer.GetCurrentFrameIndex();
 
-		ViewerData2D viewer_data;
-		viewer_data.projection = Mat4f::Ortho(0.0f, render_target.GetWidth(), render_target.GetHeight(), 0.0f);
-		static CPUBuffer buffer(sizeof(ViewerData2D));
-		std::memcpy(buffer.GetData(), &viewer_data, buffer.GetSize());
-		p_viewer_data_buffer->SetData(buffer, frame_index);
+		UniformRingBuffer::Allocation<ViewerData2D> viewer_data = RenderCore::Get().GetUniformRing().Allocate<ViewerData2D>();
+		viewer_data.data->projection = Mat4f::Ortho(0.0f, render_target.GetWidth(), render_target.GetHeight(), 0.0f);
 
 		VkCommandBuffer cmd = renderer.GetActiveCommandBuffer();
 		m_pipeline.BindPipeline(cmd, 0, {});
-		for(auto sprite : scene.GetSprites())
+		VkDescriptorSet viewer_set = p_viewer_data_set->GetSet(frame_index);
+		RenderCore::Get().vkCmdBindDescriptorSets(cmd, m_pipeline.GetPipelineBindPoint(), m_pipeline.GetPipelineLayout(), 0, 1, &viewer_set, 1, &viewer_data.offset);
+		// Sprites sharing an atlas page reuse the texture set that is already bound
+		Texture* bound_texture = nullptr;
+		for(const auto& sprite : scene.GetSprites())
 		{
 			SpriteData sprite_data;
 			sprite_data.position = Vec2f{ static_cast<float>(sprite->GetPosition().x), static_cast<float>(sprite->GetPosition().y) };
 			sprite_data.color = sprite->GetColor();
-			if(!sprite->IsSetInit())
-				sprite->UpdateDescriptorSet(*p_texture_set);
-			sprite->Bind(frame_index, cmd);
-			std::array<VkDescriptorSet, 2> sets = { p_viewer_data_set->GetSet(frame_index), sprite->GetSet(frame_index) };
-			RenderCore::Get().vkCmdBindDescriptorSets(cmd, m_pipeline.GetPipelineBindPoint(), m_pipeline.GetPipelineLayout(), 0, sets.size(), sets.data(), 0, nullptr);
+			sprite_data.uv_rect = sprite->GetUVRect();
+			if(sprite->GetTexture().get() != bound_texture)
+			{
+				if(!sprite->IsSetInit())
+					sprite->UpdateDescriptorSet(*p_texture_set);
+				sprite->Bind(frame_index, cmd);
+				VkDescriptorSet texture_set = sprite->GetSet(frame_index);
+				RenderCore::Get().vkCmdBindDescriptorSets(cmd, m_pipeline.GetPipelineBindPoint(), m_pipeline.GetPipelineLayout(), 1, 1, &texture_set, 0, nullptr);
+				bound_texture = sprite->GetTexture().get();
+			}
 			RenderCore::Get().vkCmdPushConstants(cmd, m_pipeline.GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(SpriteData), &sprite_data);
 			sprite->GetMesh()->Draw(cmd, renderer.GetDrawCallsCounterRef(), renderer.GetPolygonDrawnCounterRef());
 		}
@@ -106,7 +111,6 @@ namespace Scop
 		p_vertex_shader.reset();
 		p_fragment_shader.reset();
 		p_viewer_data_set.reset();
-		p_viewer_data_buffer->Destroy();
 		p_texture_set.reset();
 	}
 }
@@ -12,7 +12,7 @@ namespace Scop
 		ShaderLayout vertex_shader_layout(
 			{}, {}
 		);
-		p_vertex_shader = LoadShaderFromFile(ScopEngine::Get().GetAssetsPath() / "Shaders/Build/ScreenVertex.spv", ShaderType::Vertex, std::move(vertex_shader_layout));
+		p_vertex_shader = LoadShader("ScreenVertex", ShaderType::Vertex, std::move(vertex_shader_layout));
 		ShaderLayout fragment_shader_layout(
 			{
 				{ 0,
@@ -22,7 +22,7 @@ namespace Scop
 				}
 			}, {}
 		);
-		p_fragment_shader = LoadShaderFromFile(ScopEngine::Get().GetAssetsPath() / "Shaders/Build/ScreenFragment.spv", ShaderType::Fragment, std::move(fragment_shader_layout));
+		p_fragment_shader = LoadShader("ScreenFragment", ShaderType::Fragment, std::move(fragment_shader_layout));
 
 		std::function<void(const EventBase&)> functor = [this](const EventBase& event)
 		{
@@ -43,6 +43,7 @@ namespace Scop
 			pipeline_descriptor.fragment_shader = p_fragment_shader;
 			pipeline_descriptor.renderer = &renderer;
 			pipeline_descriptor.culling = VK_CULL_MODE_NONE;
+			pipeline_descriptor.blending = false;
 			pipeline_descriptor.no_vertex_inputs = true;
 			m_pipeline.Init(pipeline_descriptor);
 		}
@@ -3,20 +3,25 @@
 #include <Renderer/ViewerData.h>
 #include <Renderer/Renderer.h>
 #include <Graphics/Scene.h>
-#include <Maths/Mat4.h>
+#include <Renderer/GeometryHeap.h>
+#include <Graphics/Material.h>
+#include <Renderer/BindlessTable.h>
+#include <Graphics/Mesh.h>
+#include <Renderer/FrameArena.h>
+
+#include <array>
+#include <vector>
+#include <optional>
+#include <algorithm>
 
 namespace Scop
 {
-	struct ModelData
-	{
-		Mat4f model_mat;
-		Mat4f normal_mat;
-	};
-
 	void ForwardPass::Pass(Scene& scene, Renderer& renderer, class Texture& render_target)
 	{
 		Scene::ForwardData& data = scene.GetForwardData();
 		GraphicPipeline& pipeline = scene.GetPipeline();
+		GraphicPipeline& opaque_pipeline = scene.GetOpaquePipeline();
+		GraphicPipeline& translucent_pipeline = scene.GetTranslucentPipeline();
 
 		if(pipeline.GetPipeline() == VK_NULL_HANDLE)
 		{
@@ -28,23 +33,142 @@ namespace Scop
 			if(scene.GetForwardData().wireframe)
 				pipeline_descriptor.mode = VK_POLYGON_MODE_LINE;
 			pipeline_descriptor.clear_color_attachments = false;
+			pipeline_descriptor.blending = false;
 			pipeline.Init(pipeline_descriptor);
+
+			// Same attachments and layouts, all are used in the render pass begun by the main one
+			translucent_pipeline.Destroy();
+			pipeline_descriptor.blending = true;
+			pipeline_descriptor.depth_write = false;
+			translucent_pipeline.Init(pipeline_descriptor);
+
+			opaque_pipeline.Destroy();
+			if(scene.GetOpaqueFragmentShader())
+			{
+				pipeline_descriptor.fragment_shader = scene.GetOpaqueFragmentShader();
+				pipeline_descriptor.blending = false;
+				pipeline_descriptor.depth_write = true;
+				opaque_pipeline.Init(pipeline_descriptor);
+			}
+		}
+		bool has_opaque_pipeline = (opaque_pipeline.GetPipeline() != VK_NULL_HANDLE);
+
+		std::size_t frame_index = renderer.GetCurrentFrameIndex();
+		if(data.transforms->Update(frame_index, scene.GetActors()))
+		{
+			data.matrices_set->SetStorageBuffer(frame_index, 1, data.transforms->Get(frame_index));
+			data.matrices_set->Update(frame_index);
+		}
+
+		// Every submesh of every actor, the instance index being the actor index in the transform buffer
+		const auto& actors = scene.GetActors();
+		Vec3f camera_position = (scene.GetCamera() ? scene.GetCamera()->GetPosition() : Vec3f{ 0.0f, 0.0f, 0.0f });
+		std::pmr::vector<DrawItem> draws(&RenderCore::Get().GetFrameArena());
+		draws.reserve(actors.size()); // arena memory left behind by a growing vector is only reclaimed at the next rewind
+		for(std::size_t i = 0; i < actors.size(); i++)
+		{
+			const Model& model = actors[i]->GetModel();
+			float distance = (actors[i]->GetPosition() - camera_position).GetSquaredLength();
+			for(std::size_t j = 0; j < model.GetSubMeshCount(); j++)
+			{
+				const Mesh::SubMesh& submesh = model.GetMesh()->GetSubMesh(j);
+				if(!submesh.geometry.IsValid())
+					continue;
+				DrawItem& item = draws.emplace_back();
+				item.material = model.GetSubMeshMaterial(j);
+				item.page = submesh.geometry.page;
+				item.triangle_count = submesh.triangle_count;
+				item.command = submesh.GetDrawCommand();
+				item.command.firstInstance = static_cast<std::uint32_t>(i);
+				item.distance = distance;
+				if(item.material->IsTranslucent())
+					item.pipeline = DrawPipeline::Translucent;
+				else if(has_opaque_pipeline && item.material->IsStatic() && !submesh.has_transparent_vertices)
+					item.pipeline = DrawPipeline::Static;
+				else
+					item.pipeline = DrawPipeline::Opaque;
+			}
 		}
+		// Materials are pushed to the bindless table before its set is bound
+		for(DrawItem& item : draws)
+			item.material_index = item.material->PushToTable(frame_index);
+		// Opaque draws sharing a pipeline, a geometry page and a material are merged in a single indirect draw, front to back inside of it.
+		// Translucent ones are blended back to front, only consecutive draws of the same page and material are merged
+		std::sort(draws.begin(), draws.end(), [](const DrawItem& a, const DrawItem& b)
+		{
+			if(a.pipeline != b.pipeline)
+				return a.pipeline < b.pipeline;
+			if(a.pipeline == DrawPipeline::Translucent)
+				return a.distance > b.distance;
+			if(a.page != b.page)
+				return a.page < b.page;
+			if(a.material_index != b.material_index)
+				return a.material_index < b.material_index;
+			return a.distance < b.distance;
+		});
+		std::pmr::vector<VkDrawIndexedIndirectCommand> commands(draws.size(), &RenderCore::Get().GetFrameArena());
+		for(std::size_t i = 0; i < draws.size(); i++)
+			commands[i] = draws[i].command;
+		m_indirect.Begin(frame_index, commands.size());
 
 		VkCommandBuffer cmd = renderer.GetActiveCommandBuffer();
+		BindlessTable& table = RenderCore::Get().GetBindlessTable();
+		VkDescriptorSet table_set = table.Update(frame_index, cmd);
+		// Sets are written before any is bound, writing a bound set would invalidate the command buffer
+		if(table.IsPerMaterial())
+		{
+			for(DrawItem& item : draws)
+				item.material_set = item.material->UpdateSet(frame_index, cmd);
+		}
 		pipeline.BindPipeline(cmd, 0, {});
-		for(auto actor : scene.GetActors())
+		std::array<VkDescriptorSet, 2> sets = { data.matrices_set->GetSet(frame_index), table_set };
+		RenderCore::Get().vkCmdBindDescriptorSets(cmd, pipeline.GetPipelineBindPoint(), pipeline.GetPipelineLayout(), 0, (table.IsPerMaterial() ? 1 : sets.size()), sets.data(), 1, &data.matrices_offset);
+		std::optional<std::uint32_t> bound_page;
+		VkDescriptorSet bound_material_set = VK_NULL_HANDLE;
+		VkPipeline bound_pipeline = pipeline.GetPipeline();
+		for(std::size_t begin = 0; begin < draws.size();)
 		{
-			ModelData model_data;
-			model_data.model_mat = Mat4f::Identity();
-			model_data.model_mat.SetTranslation(actor->GetPosition() - actor->GetModel().GetCenter());
-			model_data.model_mat.SetScale(actor->GetScale());
-			model_data.model_mat = Mat4f::Translate(-actor->GetModel().GetCenter()) * Mat4f::Rotate(actor->GetOrientation()) * model_data.model_mat;
-			model_data.normal_mat = model_data.model_mat;
-			model_data.normal_mat.Inverse().Transpose();
-			RenderCore::Get().vkCmdPushConstants(cmd, pipeline.GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ModelData), &model_data);
-			actor->GetModel().Draw(cmd, *data.matrices_set, pipeline, *data.albedo_set, renderer.GetDrawCallsCounterRef(), renderer.GetPolygonDrawnCounterRef(), renderer.GetCurrentFrameIndex());
+			std::uint32_t material_index = draws[begin].material_index;
+			std::uint32_t page = draws[begin].page;
+			DrawPipeline draw_pipeline = draws[begin].pipeline;
+			std::size_t end = begin;
+			for(; end < draws.size() && draws[end].material_index == material_index && draws[end].page == page && draws[end].pipeline == draw_pipeline; end++)
+				renderer.GetPolygonDrawnCounterRef() += draws[end].triangle_count;
+
+			VkPipeline group_pipeline = pipeline.GetPipeline();
+			if(draw_pipeline == DrawPipeline::Static)
+				group_pipeline = opaque_pipeline.GetPipeline();
+			else if(draw_pipeline == DrawPipeline::Translucent)
+				group_pipeline = translucent_pipeline.GetPipeline();
+			if(group_pipeline == VK_NULL_HANDLE)
+			{
+				begin = end;
+				continue;
+			}
+			if(bound_pipeline != group_pipeline)
+			{
+				RenderCore::Get().vkCmdBindPipeline(cmd, pipeline.GetPipelineBindPoint(), group_pipeline);
+				bound_pipeline = group_pipeline;
+			}
+			if(bound_page != page)
+			{
+				RenderCore::Get().GetGeometryHeap().Bind(cmd, page);
+				bound_page = page;
+			}
+			if(table.IsPerMaterial() && bound_material_set != draws[begin].material_set)
+			{
+				bound_material_set = draws[begin].material_set;
+				RenderCore::Get().vkCmdBindDescriptorSets(cmd, pipeline.GetPipelineBindPoint(), pipeline.GetPipelineLayout(), 1, 1, &bound_material_set, 0, nullptr);
+			}
+			RenderCore::Get().vkCmdPushConstants(cmd, pipeline.GetPipelineLayout(), VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(std::uint32_t), &material_index);
+			renderer.GetDrawCallsCounterRef() += m_indirect.Draw(cmd, &commands[begin], end - begin);
+			begin = end;
 		}
 		pipeline.EndPipeline(cmd);
 	}
+
+	void ForwardPass::Destroy()
+	{
+		m_indirect.Destroy();
+	}
 }
@@ -44,6 +44,7 @@ namespace Scop
 		m_skybox.Destroy();
 		m_2Dpass.Destroy();
 		m_final.Destroy();
+		m_forward.Destroy();
 		m_main_render_texture.Destroy();
 	}
 }
@@ -15,12 +15,13 @@ namespace Scop
 			{
 				{ 0,
 					ShaderSetLayout({ 
-						{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER }
+						{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC },
+						{ 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER } // unused, the set is shared with the forward pass
 					})
 				}
 			}, {}
 		);
-		p_vertex_shader = LoadShaderFromFile(ScopEngine::Get().GetAssetsPath() / "Shaders/Build/SkyboxVertex.spv", ShaderType::Vertex, std::move(vertex_shader_layout));
+		p_vertex_shader = LoadShader("SkyboxVertex", ShaderType::Vertex, std::move(vertex_shader_layout));
 		ShaderLayout fragment_shader_layout(
 			{
 				{ 1,
@@ -30,7 +31,7 @@ namespace Scop
 				}
 			}, {}
 		);
-		p_fragment_shader = LoadShaderFromFile(ScopEngine::Get().GetAssetsPath() / "Shaders/Build/SkyboxFragment.spv", ShaderType::Fragment, std::move(fragment_shader_layout));
+		p_fragment_shader = LoadShader("SkyboxFragment", ShaderType::Fragment, std::move(fragment_shader_layout));
 
 		std::function<void(const EventBase&)> functor = [this](const EventBase& event)
 		{
@@ -56,6 +57,7 @@ namespace Scop
 			pipeline_descriptor.color_attachments = { &render_target };
 			pipeline_descriptor.depth = &scene.GetDepth();
 			pipeline_descriptor.culling = VK_CULL_MODE_NONE;
+			pipeline_descriptor.blending = false;
 			pipeline_descriptor.depth_test_equal = true;
 			pipeline_descriptor.clear_color_attachments = false;
 			m_pipeline.Init(pipeline_descriptor);
@@ -68,7 +70,7 @@ namespace Scop
 
 		m_pipeline.BindPipeline(cmd, 0, {});
 			std::array<VkDescriptorSet, 2> sets = { scene.GetForwardData().matrices_set->GetSet(renderer.GetCurrentFrameIndex()), p_set->GetSet(renderer.GetCurrentFrameIndex()) };
-			RenderCore::Get().vkCmdBindDescriptorSets(cmd, m_pipeline.GetPipelineBindPoint(), m_pipeline.GetPipelineLayout(), 0, sets.size(), sets.data(), 0, nullptr);
+			RenderCore::Get().vkCmdBindDescriptorSets(cmd, m_pipeline.GetPipelineBindPoint(), m_pipeline.GetPipelineLayout(), 0, sets.size(), sets.data(), 1, &scene.GetForwardData().matrices_offset);
 			m_cube->Draw(cmd, renderer.GetDrawCallsCounterRef(), renderer.GetPolygonDrawnCounterRef());
 		m_pipeline.EndPipeline(cmd);
 	}
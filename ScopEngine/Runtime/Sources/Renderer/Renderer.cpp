@@ -1,4 +1,9 @@
 #include <Renderer/Renderer.h>
+#include <Renderer/Buffer.h>
+#include <Renderer/Descriptor.h>
+#include <Renderer/BindlessTable.h>
+#include <Renderer/FrameArena.h>
+#include <Renderer/Pipelines/PipelineRegistry.h>
 #include <Core/Logs.h>
 #include <Core/Enums.h>
 #include <Core/Engine.h>
@@ -34,6 +39,17 @@ namespace Scop
 	void Renderer::BeginFrame()
 	{
 		kvfWaitForFence(RenderCore::Get().GetDevice(), m_cmd_fences[m_current_frame_index]);
+		RenderCore::Get().GetFrameArena().BeginFrame(m_current_frame_index);
+		// Uploads recorded since the last frame are submitted before anything that may use them
+		RenderCore::Get().GetUploadContext().Flush();
+		RenderCore::Get().GetOneShotCommands().Flush();
+		RenderCore::Get().GetAllocator().NewFrame();
+		RenderCore::Get().GetUniformRing().BeginFrame(m_current_frame_index);
+		RenderCore::Get().GetDescriptorAllocator().BeginFrame(m_current_frame_index);
+		RenderCore::Get().GetDeletionQueue().BeginFrame();
+		RenderCore::Get().GetPipelineRegistry().Update();
+		RenderCore::Get().GetBindlessTable().BeginFrame(m_current_frame_index);
+		RenderCore::Get().GetAllocator().GetDefragmenter().Update();
 		m_swapchain.AquireFrame(m_image_available_semaphores[m_current_frame_index]);
 		RenderCore::Get().vkResetCommandBuffer(m_cmd_buffers[m_current_frame_index], 0);
 		kvfBeginCommandBuffer(m_cmd_buffers[m_current_frame_index], 0);
@@ -46,6 +62,9 @@ namespace Scop
 	{
 		VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 		kvfEndCommandBuffer(m_cmd_buffers[m_current_frame_index]);
+		// Resources created during the frame must be uploaded before it executes
+		RenderCore::Get().GetUploadContext().Flush();
+		RenderCore::Get().GetOneShotCommands().Flush();
 		kvfSubmitCommandBuffer(RenderCore::Get().GetDevice(), m_cmd_buffers[m_current_frame_index], KVF_GRAPHICS_QUEUE, m_render_finished_semaphores[m_current_frame_index], m_image_available_semaphores[m_current_frame_index], m_cmd_fences[m_current_frame_index], wait_stages);
 		m_swapchain.Present(m_render_finished_semaphores[m_current_frame_index]);
 		m_current_frame_index = (m_current_frame_index + 1) % MAX_FRAMES_IN_FLIGHT;
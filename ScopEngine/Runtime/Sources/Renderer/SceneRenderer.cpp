@@ -2,8 +2,7 @@
 #include <Renderer/Renderer.h>
 #include <Graphics/Scene.h>
 #include <Renderer/ViewerData.h>
-
-#include <cstring>
+#include <Renderer/Buffer.h>
 
 namespace Scop
 {
@@ -14,21 +13,19 @@ namespace Scop
 
 	void SceneRenderer::Render(Scene& scene, Renderer& renderer)
 	{
+		UniformRingBuffer::Allocation<ViewerData> data = RenderCore::Get().GetUniformRing().Allocate<ViewerData>();
+		*data.data = ViewerData{};
 		if(scene.GetCamera())
 		{
-			ViewerData data;
-			data.projection_matrix = scene.GetCamera()->GetProj();
-			data.projection_matrix.GetInverse(&data.inv_projection_matrix);
-			data.view_matrix = scene.GetCamera()->GetView();
-			data.view_matrix.GetInverse(&data.inv_view_matrix);
-			data.view_proj_matrix = data.view_matrix * data.projection_matrix;
-			data.view_proj_matrix.GetInverse(&data.inv_view_proj_matrix);
-			data.camera_position = scene.GetCamera()->GetPosition();
-
-			static CPUBuffer buffer(sizeof(ViewerData));
-			std::memcpy(buffer.GetData(), &data, buffer.GetSize());
-			scene.GetForwardData().matrices_buffer->SetData(buffer, renderer.GetCurrentFrameIndex());
+			data.data->projection_matrix = scene.GetCamera()->GetProj();
+			data.data->projection_matrix.GetInverse(&data.data->inv_projection_matrix);
+			data.data->view_matrix = scene.GetCamera()->GetView();
+			data.data->view_matrix.GetInverse(&data.data->inv_view_matrix);
+			data.data->view_proj_matrix = data.data->view_matrix * data.data->projection_matrix;
+			data.data->view_proj_matrix.GetInverse(&data.data->inv_view_proj_matrix);
+			data.data->camera_position = scene.GetCamera()->GetPosition();
 		}
+		scene.GetForwardData().matrices_offset = data.offset;
 
 		m_passes.Pass(scene, renderer);
 	}
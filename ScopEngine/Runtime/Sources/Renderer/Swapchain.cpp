@@ -234,8 +234,8 @@ namespace Scop
 		std::vector<VkImage> tmp(m_images_count);
 		m_swapchain_images.resize(m_images_count);
 		RenderCore::Get().vkGetSwapchainImagesKHR(RenderCore::Get().GetDevice(), m_swapchain, &m_images_count, tmp.data());
-		VkCommandBuffer cmd = kvfCreateCommandBuffer(RenderCore::Get().GetDevice());
-		kvfBeginCommandBuffer(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		// Submitted with the other one shot commands, before the first frame that presents
+		VkCommandBuffer cmd = RenderCore::Get().GetOneShotCommands().Get();
 		extent = kvfGetSwapchainImagesSize(m_swapchain); // fix the extent
 		VkFormat format = kvfGetSwapchainImagesFormat(m_swapchain);
 		for(std::size_t i = 0; i < m_images_count; i++)
@@ -244,11 +244,6 @@ namespace Scop
 			m_swapchain_images[i].TransitionLayout(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, cmd);
 			m_swapchain_images[i].CreateImageView(VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT);
 		}
-		kvfEndCommandBuffer(cmd);
-		VkFence fence = kvfCreateFence(RenderCore::Get().GetDevice());
-		kvfSubmitSingleTimeCommandBuffer(RenderCore::Get().GetDevice(), cmd, KVF_GRAPHICS_QUEUE, fence);
-		kvfDestroyFence(RenderCore::Get().GetDevice(), fence);
-		kvfDestroyCommandBuffer(RenderCore::Get().GetDevice(), cmd);
 		Message("Vulkan: swapchain created with format %", VulkanFormatName(format));
 	}
 }
@@ -0,0 +1,80 @@
+#include <Renderer/TransformBuffer.h>
+#include <Graphics/Actor.h>
+#include <Core/Logs.h>
+
+#include <algorithm>
+
+namespace Scop
+{
+	void TransformBuffer::Init(std::size_t capacity)
+	{
+		for(std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+			CreateBuffer(i, capacity);
+	}
+
+	bool TransformBuffer::Update(std::size_t frame_index, const std::vector<std::shared_ptr<Actor>>& actors)
+	{
+		if(m_data.size() < actors.size())
+		{
+			m_data.resize(actors.size());
+			m_data_slots.resize(actors.size());
+		}
+		for(std::size_t i = 0; i < actors.size(); i++)
+		{
+			Slot slot{ actors[i].get(), actors[i]->GetTransformVersion() };
+			if(m_data_slots[i] == slot)
+				continue;
+			const Actor& actor = *actors[i];
+			ModelData& data = m_data[i];
+			data.model_mat = Mat4f::Identity();
+			data.model_mat.SetTranslation(actor.GetPosition() - actor.GetModel().GetCenter());
+			data.model_mat.SetScale(actor.GetScale());
+			data.model_mat = Mat4f::Translate(-actor.GetModel().GetCenter()) * Mat4f::Rotate(actor.GetOrientation()) * data.model_mat;
+			data.normal_mat = data.model_mat;
+			data.normal_mat.Inverse().Transpose();
+			m_data_slots[i] = slot;
+		}
+
+		bool recreated = false;
+		if(m_buffers[frame_index].GetSize() < actors.size() * sizeof(ModelData))
+		{
+			CreateBuffer(frame_index, std::max(actors.size(), m_buffers[frame_index].GetSize() / sizeof(ModelData) * 2));
+			recreated = true;
+		}
+
+		// Contiguous changed objects are written with a single copy
+		std::vector<Slot>& written = m_written_slots[frame_index];
+		for(std::size_t begin = 0; begin < actors.size();)
+		{
+			if(written[begin] == m_data_slots[begin])
+			{
+				begin++;
+				continue;
+			}
+			std::size_t end = begin;
+			for(; end < actors.size() && !(written[end] == m_data_slots[end]); end++)
+				written[end] = m_data_slots[end];
+			m_buffers[frame_index].Write(&m_data[begin], (end - begin) * sizeof(ModelData), begin * sizeof(ModelData));
+			begin = end;
+		}
+		return recreated;
+	}
+
+	void TransformBuffer::CreateBuffer(std::size_t frame_index, std::size_t capacity)
+	{
+		m_buffers[frame_index].Destroy();
+		m_buffers[frame_index].Init(BufferType::LowDynamic, capacity * sizeof(ModelData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, {});
+		m_written_slots[frame_index].assign(capacity, Slot{});
+	}
+
+	void TransformBuffer::Destroy() noexcept
+	{
+		for(std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			m_buffers[i].Destroy();
+			m_written_slots[i].clear();
+		}
+		m_data.clear();
+		m_data_slots.clear();
+	}
+}
@@ -0,0 +1,329 @@
+#include <Renderer/UploadContext.h>
+#include <Renderer/RenderCore.h>
+#include <Renderer/FrameArena.h>
+#include <Core/Logs.h>
+
+#include <cstring>
+#include <numeric>
+#include <algorithm>
+
+namespace Scop
+{
+	constexpr VkDeviceSize STAGING_MIN_ALIGNMENT = 16;
+
+	void UploadContext::Init(VkDeviceSize staging_size)
+	{
+		VkDevice device = RenderCore::Get().GetDevice();
+		m_ring = CreateStagingBuffer(staging_size);
+		m_ring_size = staging_size;
+		m_ring_head = 0;
+		m_ring_tail = 0;
+
+		m_graphics_family = kvfGetDeviceQueueFamily(device, KVF_GRAPHICS_QUEUE);
+		m_transfer_family = kvfGetDeviceQueueFamily(device, KVF_TRANSFER_QUEUE);
+		if(m_transfer_family != static_cast<std::uint32_t>(-1) && m_transfer_family != m_graphics_family)
+		{
+			// kvf's command pool belongs to the graphics queue family
+			VkCommandPoolCreateInfo pool_info{};
+			pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+			pool_info.queueFamilyIndex = m_transfer_family;
+			kvfCheckVk(RenderCore::Get().vkCreateCommandPool(device, &pool_info, nullptr, &m_transfer_pool));
+		}
+		else
+			m_transfer_family = m_graphics_family;
+
+		for(Batch& batch : m_batches)
+		{
+			if(UsesTransferQueue())
+			{
+				VkCommandBufferAllocateInfo alloc_info{};
+				alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				alloc_info.commandPool = m_transfer_pool;
+				alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+				alloc_info.commandBufferCount = 1;
+				kvfCheckVk(RenderCore::Get().vkAllocateCommandBuffers(device, &alloc_info, &batch.cmd));
+				batch.acquire_cmd = kvfCreateCommandBuffer(device);
+				batch.semaphore = kvfCreateSemaphore(device);
+			}
+			else
+				batch.cmd = kvfCreateCommandBuffer(device);
+			batch.fence = kvfCreateFence(device);
+		}
+		Message("Vulkan: upload context created with a % bytes staging ring%", staging_size, (UsesTransferQueue() ? " on a dedicated transfer queue" : ""));
+	}
+
+	void UploadContext::UploadBuffer(VkBuffer dst, VkDeviceSize dst_offset, const void* data, VkDeviceSize size)
+	{
+		if(size == 0)
+			return;
+		auto [staging, staging_offset] = Stage(data, size, STAGING_MIN_ALIGNMENT);
+		VkBufferCopy region{};
+		region.srcOffset = staging_offset;
+		region.dstOffset = dst_offset;
+		region.size = size;
+		RenderCore::Get().vkCmdCopyBuffer(BeginBatch(), staging, dst, 1, &region);
+
+		if(!UsesTransferQueue())
+			return; // covered by the global memory barrier of the batch
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		barrier.srcQueueFamilyIndex = m_transfer_family;
+		barrier.dstQueueFamilyIndex = m_graphics_family;
+		barrier.buffer = dst;
+		// Only the written range changes owner, the rest of the buffer may be in use by the graphics queue
+		barrier.offset = dst_offset;
+		barrier.size = size;
+		m_batches[m_current].buffer_barriers.push_back(barrier);
+	}
+
+	void UploadContext::UploadImage(VkImage dst, VkImageAspectFlags aspect, std::uint32_t layer_count, VkImageLayout final_layout, const void* data, VkDeviceSize size, const VkBufferImageCopy* regions, std::uint32_t regions_count, std::uint32_t texel_size)
+	{
+		if(size == 0 || regions_count == 0)
+			return;
+		// Buffer offsets of image copies must be a multiple of both the texel size and 4
+		VkDeviceSize alignment = std::lcm<VkDeviceSize>(std::max<VkDeviceSize>(texel_size, 1), STAGING_MIN_ALIGNMENT);
+		auto [staging, staging_offset] = Stage(data, size, alignment);
+		std::pmr::vector<VkBufferImageCopy> staged_regions(regions, regions + regions_count, &RenderCore::Get().GetFrameArena());
+		for(VkBufferImageCopy& region : staged_regions)
+			region.bufferOffset += staging_offset;
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = dst;
+		barrier.subresourceRange.aspectMask = aspect;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.layerCount = layer_count;
+		VkCommandBuffer cmd = BeginBatch();
+		RenderCore::Get().vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		RenderCore::Get().vkCmdCopyBufferToImage(cmd, staging, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, staged_regions.size(), staged_regions.data());
+
+		// Transition to the final layout, and queue family ownership transfer if needed, when the batch is submitted
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = final_layout;
+		if(UsesTransferQueue())
+		{
+			barrier.srcQueueFamilyIndex = m_transfer_family;
+			barrier.dstQueueFamilyIndex = m_graphics_family;
+		}
+		m_batches[m_current].image_barriers.push_back(barrier);
+	}
+
+	VkCommandBuffer UploadContext::BeginBatch()
+	{
+		Batch& batch = m_batches[m_current];
+		if(m_recording)
+			return batch.cmd;
+		if(m_in_flight_count == BATCH_COUNT)
+			RetireOldest(true);
+		RenderCore::Get().vkResetCommandBuffer(batch.cmd, 0);
+		kvfBeginCommandBuffer(batch.cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		batch.value = m_next_value++;
+		m_recording = true;
+		return batch.cmd;
+	}
+
+	std::uint64_t UploadContext::Flush()
+	{
+		if(!m_recording)
+			return m_next_value - 1;
+		Batch& batch = m_batches[m_current];
+		VkDevice device = RenderCore::Get().GetDevice();
+
+		if(UsesTransferQueue())
+		{
+			// Release on the transfer queue, then acquire on the graphics queue once the copies are done
+			RenderCore::Get().vkCmdPipelineBarrier(batch.cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, batch.buffer_barriers.size(), batch.buffer_barriers.data(), batch.image_barriers.size(), batch.image_barriers.data());
+			kvfEndCommandBuffer(batch.cmd);
+			kvfSubmitCommandBuffer(device, batch.cmd, KVF_TRANSFER_QUEUE, batch.semaphore, VK_NULL_HANDLE, VK_NULL_HANDLE, nullptr);
+
+			for(VkBufferMemoryBarrier& barrier : batch.buffer_barriers)
+				barrier.srcAccessMask = 0;
+			for(VkImageMemoryBarrier& barrier : batch.image_barriers)
+				barrier.srcAccessMask = 0;
+			RenderCore::Get().vkResetCommandBuffer(batch.acquire_cmd, 0);
+			kvfBeginCommandBuffer(batch.acquire_cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+			RenderCore::Get().vkCmdPipelineBarrier(batch.acquire_cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, batch.buffer_barriers.size(), batch.buffer_barriers.data(), batch.image_barriers.size(), batch.image_barriers.data());
+			kvfEndCommandBuffer(batch.acquire_cmd);
+			VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			kvfSubmitCommandBuffer(device, batch.acquire_cmd, KVF_GRAPHICS_QUEUE, VK_NULL_HANDLE, batch.semaphore, batch.fence, &wait_stage);
+		}
+		else
+		{
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+			RenderCore::Get().vkCmdPipelineBarrier(batch.cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, batch.image_barriers.size(), batch.image_barriers.data());
+			kvfEndCommandBuffer(batch.cmd);
+			kvfSubmitCommandBuffer(device, batch.cmd, KVF_GRAPHICS_QUEUE, VK_NULL_HANDLE, VK_NULL_HANDLE, batch.fence, nullptr);
+		}
+		batch.buffer_barriers.clear();
+		batch.image_barriers.clear();
+
+		batch.ring_end = m_ring_head;
+		m_current = (m_current + 1) % BATCH_COUNT;
+		m_in_flight_count++;
+		m_recording = false;
+		while(m_in_flight_count > 0 && RetireOldest(false));
+		return batch.value;
+	}
+
+	void UploadContext::Wait(std::uint64_t value)
+	{
+		if(m_recording && value >= m_batches[m_current].value)
+			Flush();
+		while(m_completed_value < value && m_in_flight_count > 0)
+			RetireOldest(true);
+	}
+
+	void UploadContext::WaitIdle()
+	{
+		if(!HasPendingUploads())
+			return;
+		Flush();
+		while(m_in_flight_count > 0)
+			RetireOldest(true);
+	}
+
+	bool UploadContext::IsComplete(std::uint64_t value)
+	{
+		while(m_in_flight_count > 0 && RetireOldest(false));
+		return m_completed_value >= value;
+	}
+
+	void UploadContext::Destroy() noexcept
+	{
+		if(m_ring.buffer == VK_NULL_HANDLE)
+			return;
+		WaitIdle();
+		VkDevice device = RenderCore::Get().GetDevice();
+		for(Batch& batch : m_batches)
+		{
+			kvfDestroyFence(device, batch.fence);
+			if(UsesTransferQueue())
+			{
+				kvfDestroySemaphore(device, batch.semaphore);
+				kvfDestroyCommandBuffer(device, batch.acquire_cmd);
+			}
+			else
+				kvfDestroyCommandBuffer(device, batch.cmd);
+			batch.fence = VK_NULL_HANDLE;
+			batch.semaphore = VK_NULL_HANDLE;
+			batch.cmd = VK_NULL_HANDLE;
+			batch.acquire_cmd = VK_NULL_HANDLE;
+		}
+		if(UsesTransferQueue())
+			RenderCore::Get().vkDestroyCommandPool(device, m_transfer_pool, nullptr); // also frees the transfer command buffers
+		m_transfer_pool = VK_NULL_HANDLE;
+		DestroyStagingBuffer(m_ring);
+		Message("Vulkan: upload context destroyed");
+	}
+
+	UploadContext::StagingBuffer UploadContext::CreateStagingBuffer(VkDeviceSize size)
+	{
+		VkDevice device = RenderCore::Get().GetDevice();
+		StagingBuffer staging;
+		staging.buffer = kvfCreateBuffer(device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, size);
+		VkMemoryRequirements mem_requirements;
+		RenderCore::Get().vkGetBufferMemoryRequirements(device, staging.buffer, &mem_requirements);
+		staging.memory = RenderCore::Get().GetAllocator().Allocate(mem_requirements.size, mem_requirements.alignment, *FindMemoryType(mem_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+		RenderCore::Get().vkBindBufferMemory(device, staging.buffer, staging.memory.memory, staging.memory.offset);
+		if(staging.memory.map == nullptr)
+			FatalError("Vulkan: unable to map a staging buffer");
+		return staging;
+	}
+
+	void UploadContext::DestroyStagingBuffer(StagingBuffer& buffer) noexcept
+	{
+		if(buffer.buffer == VK_NULL_HANDLE)
+			return;
+		RenderCore::Get().vkDestroyBuffer(RenderCore::Get().GetDevice(), buffer.buffer, nullptr);
+		RenderCore::Get().GetAllocator().Deallocate(buffer.memory);
+		buffer.buffer = VK_NULL_HANDLE;
+		buffer.memory = NULL_MEMORY_BLOCK;
+	}
+
+	std::optional<VkDeviceSize> UploadContext::AllocateStaging(VkDeviceSize size, VkDeviceSize alignment) noexcept
+	{
+		// Free space is [head, end) + [0, tail) when head >= tail and [head, tail) otherwise,
+		// head never catches up with tail so that head == tail means the ring is empty
+		VkDeviceSize offset = (m_ring_head + alignment - 1) / alignment * alignment;
+		if(m_ring_head >= m_ring_tail)
+		{
+			if(offset + size <= m_ring_size)
+			{
+				m_ring_head = offset + size;
+				return offset;
+			}
+			if(size < m_ring_tail)
+			{
+				m_ring_head = size;
+				return 0;
+			}
+		}
+		else if(offset + size < m_ring_tail)
+		{
+			m_ring_head = offset + size;
+			return offset;
+		}
+		return std::nullopt;
+	}
+
+	std::pair<VkBuffer, VkDeviceSize> UploadContext::Stage(const void* data, VkDeviceSize size, VkDeviceSize alignment)
+	{
+		if(size > m_ring_size / 2)
+		{
+			StagingBuffer staging = CreateStagingBuffer(size);
+			std::memcpy(staging.memory.map, data, size);
+			BeginBatch();
+			m_batches[m_current].retained_buffers.push_back(staging);
+			return { staging.buffer, 0 };
+		}
+		std::optional<VkDeviceSize> offset = AllocateStaging(size, alignment);
+		while(!offset.has_value())
+		{
+			// Waits for the oldest batches first, the batch being recorded is only submitted when it holds the whole ring
+			if(m_in_flight_count == 0)
+				Flush();
+			RetireOldest(true);
+			offset = AllocateStaging(size, alignment);
+		}
+		std::memcpy(reinterpret_cast<std::uint8_t*>(m_ring.memory.map) + *offset, data, size);
+		return { m_ring.buffer, *offset };
+	}
+
+	bool UploadContext::RetireOldest(bool wait) noexcept
+	{
+		if(m_in_flight_count == 0)
+			return false;
+		Batch& batch = m_batches[m_oldest];
+		if(wait)
+			kvfWaitForFence(RenderCore::Get().GetDevice(), batch.fence);
+		else if(RenderCore::Get().vkGetFenceStatus(RenderCore::Get().GetDevice(), batch.fence) != VK_SUCCESS)
+			return false;
+		for(StagingBuffer& staging : batch.retained_buffers)
+			DestroyStagingBuffer(staging);
+		batch.retained_buffers.clear();
+		m_ring_tail = batch.ring_end;
+		m_completed_value = batch.value;
+		m_oldest = (m_oldest + 1) % BATCH_COUNT;
+		m_in_flight_count--;
+		if(m_in_flight_count == 0 && m_ring_head == m_ring_tail)
+		{
+			m_ring_head = 0;
+			m_ring_tail = 0;
+		}
+		return true;
+	}
+}
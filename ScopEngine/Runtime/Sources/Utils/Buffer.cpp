@@ -0,0 +1,110 @@
+#include <Utils/Buffer.h>
+
+#include <new>
+#include <cstddef>
+#include <algorithm>
+
+#ifdef __linux__
+	#include <sys/mman.h>
+#endif
+
+namespace Scop
+{
+	namespace
+	{
+		constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+	}
+
+	CPUBuffer::CPUBuffer(std::size_t size, CPUBufferPolicy policy, std::size_t alignment) : m_size(size), m_capacity(size), m_alignment(std::max(alignment, alignof(std::max_align_t))), m_policy(policy)
+	{
+		if(size == 0)
+			return;
+		if(m_policy == CPUBufferPolicy::View)
+			FatalError("a CPU buffer view cannot allocate, use CPUBuffer::Wrap");
+		try
+		{
+			switch(m_policy)
+			{
+				case CPUBufferPolicy::Heap: m_data = new std::uint8_t[size]; break;
+				case CPUBufferPolicy::Aligned: m_data = static_cast<std::uint8_t*>(::operator new(size, std::align_val_t{ m_alignment })); break;
+				case CPUBufferPolicy::HugePages:
+				{
+					#ifdef __linux__
+						m_capacity = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+						void* map = mmap(nullptr, m_capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+						if(map != MAP_FAILED)
+						{
+							// Only a hint, the kernel may still back it with regular pages
+							madvise(map, m_capacity, MADV_HUGEPAGE);
+							m_data = static_cast<std::uint8_t*>(map);
+							break;
+						}
+						Warning("CPU buffer: mapping of % bytes failed, falling back to the heap", m_capacity);
+					#endif
+					m_capacity = size;
+					m_policy = CPUBufferPolicy::Aligned;
+					m_data = static_cast<std::uint8_t*>(::operator new(size, std::align_val_t{ m_alignment }));
+					break;
+				}
+
+				default: break;
+			}
+		}
+		catch(...)
+		{
+			FatalError("memory allocation for a CPU buffer failed");
+		}
+	}
+
+	CPUBuffer::CPUBuffer(CPUBuffer&& buffer) noexcept
+	{
+		*this = std::move(buffer);
+	}
+
+	CPUBuffer CPUBuffer::Wrap(void* data, std::size_t size) noexcept
+	{
+		CPUBuffer buffer;
+		buffer.m_data = static_cast<std::uint8_t*>(data);
+		buffer.m_size = size;
+		buffer.m_capacity = size;
+		buffer.m_policy = CPUBufferPolicy::View;
+		return buffer;
+	}
+
+	CPUBuffer& CPUBuffer::operator=(CPUBuffer&& buffer) noexcept
+	{
+		if(this == &buffer)
+			return *this;
+		Release();
+		m_data = std::exchange(buffer.m_data, nullptr);
+		m_size = std::exchange(buffer.m_size, 0);
+		m_capacity = std::exchange(buffer.m_capacity, 0);
+		m_alignment = buffer.m_alignment;
+		m_policy = buffer.m_policy;
+		return *this;
+	}
+
+	void CPUBuffer::Release() noexcept
+	{
+		if(m_data == nullptr)
+			return;
+		switch(m_policy)
+		{
+			case CPUBufferPolicy::Heap: delete[] m_data; break;
+			case CPUBufferPolicy::Aligned: ::operator delete(m_data, std::align_val_t{ m_alignment }); break;
+			#ifdef __linux__
+				case CPUBufferPolicy::HugePages: munmap(m_data, m_capacity); break;
+			#endif
+
+			default: break;
+		}
+		m_data = nullptr;
+		m_size = 0;
+		m_capacity = 0;
+	}
+
+	CPUBuffer::~CPUBuffer()
+	{
+		Release();
+	}
+}
@@ -70,7 +70,8 @@ typedef enum
 {
 	KVF_GRAPHICS_QUEUE = 0,
 	KVF_PRESENT_QUEUE = 1,
-	KVF_COMPUTE_QUEUE = 2
+	KVF_COMPUTE_QUEUE = 2,
+	KVF_TRANSFER_QUEUE = 3 // Only available if the device exposes a transfer-only queue family
 } KvfQueueType;
 
 typedef enum
@@ -125,6 +126,7 @@ int32_t kvfFindDeviceQueueFamily(VkPhysicalDevice physical, KvfQueueType type);
 
 VkDevice kvfCreateDefaultDevice(VkPhysicalDevice physical);
 VkDevice kvfCreateDevice(VkPhysicalDevice physical, const char** extensions, uint32_t extensions_count, VkPhysicalDeviceFeatures* features);
+VkDevice kvfCreateDeviceWithNext(VkPhysicalDevice physical, const char** extensions, uint32_t extensions_count, VkPhysicalDeviceFeatures* features, const void* next);
 VkDevice kvfCreateDefaultDevicePhysicalDeviceAndCustomQueues(VkPhysicalDevice physical, int32_t graphics_queue, int32_t present_queue, int32_t compute_queue);
 VkDevice kvfCreateDeviceCustomPhysicalDeviceAndQueues(VkPhysicalDevice physical, const char** extensions, uint32_t extensions_count, VkPhysicalDeviceFeatures* features, int32_t graphics_queue, int32_t present_queue, int32_t compute_queue);
 #ifdef KVF_IMPL_VK_NO_PROTOTYPES
@@ -386,6 +388,7 @@ typedef struct
 	int32_t graphics;
 	int32_t present;
 	int32_t compute;
+	int32_t transfer;
 } __KvfQueueFamilies;
 
 typedef struct __KvfDescriptorPool
@@ -519,7 +522,7 @@ void kvfCheckVk(VkResult result)
 	__kvfCheckVk(result);
 }
 
-void __kvfAddDeviceToArray(VkPhysicalDevice device, int32_t graphics_queue, int32_t present_queue, int32_t compute_queue)
+void __kvfAddDeviceToArray(VkPhysicalDevice device, int32_t graphics_queue, int32_t present_queue, int32_t compute_queue, int32_t transfer_queue)
 {
 	KVF_ASSERT(device != VK_NULL_HANDLE);
 	if(__kvf_internal_devices_size == __kvf_internal_devices_capacity)
@@ -533,6 +536,7 @@ void __kvfAddDeviceToArray(VkPhysicalDevice device, int32_t graphics_queue, int3
 	__kvf_internal_devices[__kvf_internal_devices_size].queues.graphics = graphics_queue;
 	__kvf_internal_devices[__kvf_internal_devices_size].queues.compute = compute_queue;
 	__kvf_internal_devices[__kvf_internal_devices_size].queues.present = present_queue;
+	__kvf_internal_devices[__kvf_internal_devices_size].queues.transfer = transfer_queue;
 	__kvf_internal_devices_size++;
 }
 
@@ -574,7 +578,7 @@ void __kvfCompleteDeviceCustomPhysicalDeviceAndQueues(VkPhysicalDevice physical,
 	KVF_ASSERT(device != VK_NULL_HANDLE);
 	KVF_ASSERT(physical != VK_NULL_HANDLE);
 
-	__kvfAddDeviceToArray(physical, graphics_queue, present_queue, compute_queue);
+	__kvfAddDeviceToArray(physical, graphics_queue, present_queue, compute_queue, -1);
 
 	__KvfDevice* kvf_device = NULL;
 
@@ -1356,7 +1360,7 @@ void kvfDestroyInstance(VkInstance instance)
 
 __KvfQueueFamilies __kvfFindQueueFamilies(VkPhysicalDevice physical, VkSurfaceKHR surface)
 {
-	__KvfQueueFamilies queues = { -1, -1, -1 };
+	__KvfQueueFamilies queues = { -1, -1, -1, -1 };
 	uint32_t queue_family_count;
 	KVF_GET_INSTANCE_FUNCTION(vkGetPhysicalDeviceQueueFamilyProperties)(physical, &queue_family_count, NULL);
 	VkQueueFamilyProperties* queue_families = (VkQueueFamilyProperties*)KVF_MALLOC(sizeof(VkQueueFamilyProperties) * queue_family_count);
@@ -1389,6 +1393,15 @@ __KvfQueueFamilies __kvfFindQueueFamilies(VkPhysicalDevice physical, VkSurfaceKH
 				break;
 		#endif
 	}
+	for(uint32_t i = 0; i < queue_family_count; i++)
+	{
+		// dedicated transfer queues (DMA engines) support neither graphics nor compute
+		if(queue_families[i].queueFlags & VK_QUEUE_TRANSFER_BIT && (queue_families[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == 0)
+		{
+			queues.transfer = i;
+			break;
+		}
+	}
 	KVF_FREE(queue_families);
 	return queues;
 }
@@ -1408,7 +1421,7 @@ VkPhysicalDevice kvfPickFirstPhysicalDevice(VkInstance instance, VkSurfaceKHR su
 	chosen_one = devices[0];
 	KVF_FREE(devices);
 	__KvfQueueFamilies queues = __kvfFindQueueFamilies(chosen_one, surface);
-	__kvfAddDeviceToArray(chosen_one, queues.graphics, queues.present, queues.present);
+	__kvfAddDeviceToArray(chosen_one, queues.graphics, queues.present, queues.present, queues.transfer);
 	return chosen_one;
 }
 
@@ -1511,7 +1524,7 @@ VkPhysicalDevice kvfPickGoodPhysicalDevice(VkInstance instance, VkSurfaceKHR sur
 	if(chosen_one != VK_NULL_HANDLE)
 	{
 		__KvfQueueFamilies queues = __kvfFindQueueFamilies(chosen_one, surface);
-		__kvfAddDeviceToArray(chosen_one, queues.graphics, queues.present, queues.compute);
+		__kvfAddDeviceToArray(chosen_one, queues.graphics, queues.present, queues.compute, queues.transfer);
 		return chosen_one;
 	}
 	return VK_NULL_HANDLE;
@@ -1525,6 +1538,11 @@ VkDevice kvfCreateDefaultDevice(VkPhysicalDevice physical)
 }
 
 VkDevice kvfCreateDevice(VkPhysicalDevice physical, const char** extensions, uint32_t extensions_count, VkPhysicalDeviceFeatures* features)
+{
+	return kvfCreateDeviceWithNext(physical, extensions, extensions_count, features, NULL);
+}
+
+VkDevice kvfCreateDeviceWithNext(VkPhysicalDevice physical, const char** extensions, uint32_t extensions_count, VkPhysicalDeviceFeatures* features, const void* next)
 {
 	const float queue_priority = 1.0f;
 
@@ -1536,6 +1554,7 @@ VkDevice kvfCreateDevice(VkPhysicalDevice physical, const char** extensions, uin
 	queue_count += (kvf_device->queues.graphics != -1);
 	queue_count += (kvf_device->queues.present != -1);
 	queue_count += (kvf_device->queues.compute != -1);
+	queue_count += (kvf_device->queues.transfer != -1);
 
 	VkDeviceQueueCreateInfo* queue_create_infos = (VkDeviceQueueCreateInfo*)KVF_MALLOC(queue_count * sizeof(VkDeviceQueueCreateInfo));
 	KVF_ASSERT(queue_create_infos != NULL && "allocation failed :(");
@@ -1570,6 +1589,16 @@ VkDevice kvfCreateDevice(VkPhysicalDevice physical, const char** extensions, uin
 		queue_create_infos[i].pNext = NULL;
 		i++;
 	}
+	if(kvf_device->queues.transfer != -1 && kvf_device->queues.transfer != kvf_device->queues.graphics && kvf_device->queues.transfer != kvf_device->queues.present && kvf_device->queues.transfer != kvf_device->queues.compute)
+	{
+		queue_create_infos[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queue_create_infos[i].queueFamilyIndex = kvf_device->queues.transfer;
+		queue_create_infos[i].queueCount = 1;
+		queue_create_infos[i].pQueuePriorities = &queue_priority;
+		queue_create_infos[i].flags = 0;
+		queue_create_infos[i].pNext = NULL;
+		i++;
+	}
 
 	VkDeviceCreateInfo createInfo;
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -1581,7 +1610,7 @@ VkDevice kvfCreateDevice(VkPhysicalDevice physical, const char** extensions, uin
 	createInfo.enabledLayerCount = 0;
 	createInfo.ppEnabledLayerNames = NULL;
 	createInfo.flags = 0;
-	createInfo.pNext = NULL;
+	createInfo.pNext = next;
 
 	VkDevice device;
 	__kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateDevice)(physical, &createInfo, NULL, &device));
@@ -1703,6 +1732,11 @@ VkQueue kvfGetDeviceQueue(VkDevice device, KvfQueueType queue)
 		KVF_ASSERT(kvf_device->queues.compute != -1);
 		KVF_GET_DEVICE_FUNCTION(vkGetDeviceQueue)(device, kvf_device->queues.compute, 0, &vk_queue);
 	}
+	else if(queue == KVF_TRANSFER_QUEUE)
+	{
+		KVF_ASSERT(kvf_device->queues.transfer != -1);
+		KVF_GET_DEVICE_FUNCTION(vkGetDeviceQueue)(device, kvf_device->queues.transfer, 0, &vk_queue);
+	}
 	return vk_queue;
 }
 
@@ -1717,6 +1751,8 @@ uint32_t kvfGetDeviceQueueFamily(VkDevice device, KvfQueueType queue)
 		return kvf_device->queues.present;
 	else if(queue == KVF_COMPUTE_QUEUE)
 		return kvf_device->queues.compute;
+	else if(queue == KVF_TRANSFER_QUEUE)
+		return kvf_device->queues.transfer;
 	KVF_ASSERT(false && "invalid queue");
 	return 0;
 }